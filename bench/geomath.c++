@@ -0,0 +1,136 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <QtCore/QPointF>
+#include <QtPositioning/QGeoCoordinate>
+#include "CCL/Geomath"
+
+#define in :
+
+using namespace CCL;
+using std::vector;
+
+namespace
+{
+  const QGeoCoordinate ORIGIN(55.75, 37.61, 150);
+
+  /// Points scattered up to 50 km around ORIGIN, fixed seed so runs compare.
+  vector<QGeoCoordinate> scatter(size_t count)
+  {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> distance(0, 50'000);
+    std::uniform_real_distribution<double> azimuth(0, 360);
+    vector<QGeoCoordinate> ret;
+    ret.reserve(count);
+    for(size_t i = 0; i < count; i++)
+      ret.push_back(ORIGIN.atDistanceAndAzimuth(distance(random), azimuth(random)));
+    return ret;
+  }
+} // namespace
+
+static void BM_geo2NED(benchmark::State& state)
+{
+  vector<QGeoCoordinate> points = scatter(static_cast<size_t>(state.range(0)));
+  for(auto _ in state)
+    for(const QGeoCoordinate& point in points)
+      benchmark::DoNotOptimize(geo2NED(point, ORIGIN));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_geo2NED)->Arg(1'000)->Arg(100'000);
+
+static void BM_ned2geo(benchmark::State& state)
+{
+  vector<NEDPoint> points;
+  for(const QGeoCoordinate& point in scatter(static_cast<size_t>(state.range(0))))
+    points.push_back(geo2NED(point, ORIGIN));
+  for(auto _ in state)
+    for(const NEDPoint& point in points)
+      benchmark::DoNotOptimize(ned2geo(point, ORIGIN));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ned2geo)->Arg(1'000)->Arg(100'000);
+
+static void BM_geo2webmercator(benchmark::State& state)
+{
+  vector<QGeoCoordinate> points = scatter(static_cast<size_t>(state.range(0)));
+  for(auto _ in state)
+    for(const QGeoCoordinate& point in points)
+      benchmark::DoNotOptimize(geo2webmercator(point, 19));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_geo2webmercator)->Arg(100'000);
+
+// Scalar frame loop against the vectorized batch overloads, points per second on the same input.
+static void BM_FrameToNEDScalar(benchmark::State& state)
+{
+  vector<QGeoCoordinate> points = scatter(static_cast<size_t>(state.range(0)));
+  LocalTangentFrame frame(ORIGIN);
+  for(auto _ in state)
+    for(const QGeoCoordinate& point in points)
+      benchmark::DoNotOptimize(frame.toNED(point));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FrameToNEDScalar)->Arg(1'000)->Arg(100'000);
+
+static void BM_FrameToNEDBatch(benchmark::State& state)
+{
+  const size_t count = static_cast<size_t>(state.range(0));
+  vector<double> latitude, longitude, north(count), east(count);
+  for(const QGeoCoordinate& point in scatter(count))
+  {
+    latitude.push_back(point.latitude());
+    longitude.push_back(point.longitude());
+  }
+  LocalTangentFrame frame(ORIGIN);
+  for(auto _ in state)
+  {
+    frame.toNED(count, latitude.data(), longitude.data(), nullptr, north.data(), east.data(), nullptr);
+    benchmark::DoNotOptimize(north.data());
+    benchmark::DoNotOptimize(east.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FrameToNEDBatch)->Arg(1'000)->Arg(100'000);
+
+static void BM_FrameToGeoScalar(benchmark::State& state)
+{
+  LocalTangentFrame frame(ORIGIN);
+  vector<NEDPoint> points;
+  for(const QGeoCoordinate& point in scatter(static_cast<size_t>(state.range(0))))
+    points.push_back(frame.toNED(point));
+  for(auto _ in state)
+    for(const NEDPoint& point in points)
+      benchmark::DoNotOptimize(frame.toGeo(point));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FrameToGeoScalar)->Arg(1'000)->Arg(100'000);
+
+static void BM_FrameToGeoBatch(benchmark::State& state)
+{
+  const size_t count = static_cast<size_t>(state.range(0));
+  LocalTangentFrame frame(ORIGIN);
+  vector<double> north, east, latitude(count), longitude(count);
+  for(const QGeoCoordinate& point in scatter(count))
+  {
+    NEDPoint ned = frame.toNED(point);
+    north.push_back(ned.x);
+    east.push_back(ned.y);
+  }
+  for(auto _ in state)
+  {
+    frame.toGeo(count, north.data(), east.data(), nullptr, latitude.data(), longitude.data(), nullptr);
+    benchmark::DoNotOptimize(latitude.data());
+    benchmark::DoNotOptimize(longitude.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FrameToGeoBatch)->Arg(1'000)->Arg(100'000);
@@ -0,0 +1,22 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <benchmark/benchmark.h>
+#include <QtCore/QCoreApplication>
+
+// Download benchmarks drive TileLoader through the event loop, which needs an application object.
+int main(int argc, char** argv)
+{
+  ::benchmark::Initialize(&argc, argv);
+  if(::benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  QCoreApplication app(argc, argv);
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
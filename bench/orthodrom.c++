@@ -0,0 +1,46 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <QtPositioning/QGeoCoordinate>
+#include "CCL/Orthodrom"
+
+#define in :
+
+using namespace CCL;
+
+/// Argument is the leg length in km, Orthodrom keeps one point per 10 km.
+static void BM_Orthodrom(benchmark::State& state)
+{
+  QGeoCoordinate first(55.75, 37.61);
+  QGeoCoordinate second = first.atDistanceAndAzimuth(static_cast<double>(state.range(0)) * 1'000, 60);
+  int points = 0;
+  for(auto _ in state)
+  {
+    QList<QVariant> path = Orthodrom(first, second).get();
+    benchmark::DoNotOptimize(points = path.size());
+  }
+  state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(BM_Orthodrom)->Arg(100)->Arg(1'000)->Arg(10'000);
+
+/// Argument is the point count sampled along a transatlantic arc into caller buffers.
+static void BM_GreatCircleSample(benchmark::State& state)
+{
+  GreatCircle arc({ 40.64, -73.78 }, { 51.47, -0.45 });
+  const size_t count = static_cast<size_t>(state.range(0));
+  std::vector<double> latitude(count), longitude(count);
+  for(auto _ in state)
+  {
+    arc.sample(count, latitude.data(), longitude.data());
+    benchmark::DoNotOptimize(latitude.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GreatCircleSample)->Arg(100)->Arg(10'000)->Arg(1'000'000);
@@ -0,0 +1,94 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <QtCore/QTemporaryDir>
+#include <QtPositioning/QGeoPolygon>
+#include "CCL/TileLoader"
+#include "CCL/TileStorage"
+#include "../tests/fixtures.h"
+#include "../tests/httpstub.h"
+
+#define in :
+
+using namespace CCL;
+using namespace CCL::Testing;
+using std::vector;
+
+static void BM_TileMath(benchmark::State& state)
+{
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> latitude(-85, 85);
+  std::uniform_real_distribution<double> longitude(-180, 180);
+  vector<std::pair<double, double>> points(static_cast<size_t>(state.range(0)));
+  for(auto& point in points)
+    point = { latitude(random), longitude(random) };
+
+  for(auto _ in state)
+  {
+    for(const auto& point in points)
+    {
+      uint32_t x = TileLoader::longitudeToTileX(point.second, 18);
+      uint32_t y = TileLoader::latitudeToTileY(point.first, 18);
+      benchmark::DoNotOptimize(TileLoader::tileXToLongitude(x, 18));
+      benchmark::DoNotOptimize(TileLoader::tileYToLatitude(y, 18));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TileMath)->Arg(100'000);
+
+/// 50 km wide concave survey area, estimated down to the zoom given as argument.
+static void BM_Estimate(benchmark::State& state)
+{
+  QList<QVariant> area = toVariantList(starPolygon({ 55.75, 37.61 }, 25'000, 64));
+  int tiles = 0;
+  for(auto _ in state)
+    benchmark::DoNotOptimize(tiles = TileLoader::estimate(area, static_cast<int>(state.range(0))));
+  state.counters["tiles"] = tiles;
+}
+BENCHMARK(BM_Estimate)->DenseRange(12, 20, 2)->Unit(benchmark::kMicrosecond);
+
+/// Download pipeline throughput against the local HTTP stub, argument is the tile payload size.
+static void BM_Download(benchmark::State& state)
+{
+  HttpStub stub(QByteArray(static_cast<int>(state.range(0)), 'x'));
+  QGeoPolygon area = regularPolygon({ 55.75, 37.61 }, 4'000, 8);
+  const vector<TileKey> tiles = coveredTiles(area, 0, 15);
+
+  for(auto _ in state)
+  {
+    state.PauseTiming();
+    QTemporaryDir directory;
+    TileLoader loader(directory.path());
+    loader.setServerUrl(stub.urlTemplate());
+    DirectoryTileStorage storage(directory.path());
+    vector<TileKey> pending = tiles;
+    state.ResumeTiming();
+
+    loader.download(area, 15);
+    bool done = waitFor([&]() {
+      pending.erase(std::remove_if(pending.begin(), pending.end(), [&storage](TileKey key) {
+        return storage.contains(tileKeyZoom(key), tileKeyX(key), tileKeyY(key));
+      }), pending.end());
+      return pending.empty();
+    }, 60'000);
+
+    if(not done)
+    {
+      state.SkipWithError("download did not finish");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tiles.size()));
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(tiles.size()) * state.range(0));
+}
+BENCHMARK(BM_Download)->Arg(1'024)->Arg(32 * 1'024)->Unit(benchmark::kMillisecond)->UseRealTime();
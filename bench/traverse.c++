@@ -0,0 +1,110 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <QtCore/QFuture>
+#include <QtCore/QThreadPool>
+#include <QtPositioning/QGeoPath>
+#include <QtPositioning/QGeoPolygon>
+#include "CCL/Traverse"
+#include "CCL/TraverseBatch"
+#include "../tests/fixtures.h"
+#include "../tests/legacytraverse.h"
+
+#define in :
+
+using namespace CCL;
+using namespace CCL::Testing;
+
+namespace
+{
+  const QGeoCoordinate CENTER(55.75, 37.61);
+} // namespace
+
+/// Argument is the vertex count of a 2 km radius outline flown with 5 m spacing.
+static void BM_BuildTraverse(benchmark::State& state)
+{
+  QGeoPolygon polygon = regularPolygon(CENTER, 2'000, static_cast<int>(state.range(0)));
+  int waypoints = 0;
+  for(auto _ in state)
+  {
+    QGeoPath path = Traverse::buildTraverse(polygon, 30, 5, 10, Traverse::Entry::TopLeft);
+    benchmark::DoNotOptimize(waypoints = path.size());
+  }
+  state.counters["waypoints"] = waypoints;
+  state.SetItemsProcessed(state.iterations() * waypoints);
+}
+BENCHMARK(BM_BuildTraverse)->Arg(4)->Arg(16)->Arg(100)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMillisecond);
+
+static void BM_BuildTraverseConcave(benchmark::State& state)
+{
+  QGeoPolygon polygon = starPolygon(CENTER, 2'000, static_cast<int>(state.range(0)));
+  int waypoints = 0;
+  for(auto _ in state)
+  {
+    QGeoPath path = Traverse::buildTraverse(polygon, 30, 5, 10, Traverse::Entry::TopLeft);
+    benchmark::DoNotOptimize(waypoints = path.size());
+  }
+  state.counters["waypoints"] = waypoints;
+  state.SetItemsProcessed(state.iterations() * waypoints);
+}
+BENCHMARK(BM_BuildTraverseConcave)->Arg(16)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMillisecond);
+
+/// Pre-Planner implementation on the same input as BM_BuildTraverse: every transect of the padded bounding square against every edge.
+static void BM_BuildTraverseLegacy(benchmark::State& state)
+{
+  QGeoPolygon polygon = regularPolygon(CENTER, 2'000, static_cast<int>(state.range(0)));
+  int waypoints = 0;
+  for(auto _ in state)
+  {
+    QGeoPath path = legacyBuildTraverse(polygon, 30, 5, 10, Traverse::Entry::TopLeft);
+    benchmark::DoNotOptimize(waypoints = path.size());
+  }
+  state.counters["waypoints"] = waypoints;
+  state.SetItemsProcessed(state.iterations() * waypoints);
+}
+BENCHMARK(BM_BuildTraverseLegacy)->Arg(4)->Arg(16)->Arg(100)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMillisecond);
+
+namespace
+{
+  /// count 2 km outlines of 16 to 1000 vertices at varied angles.
+  QList<Traverse::Job> batchOf(int count)
+  {
+    QList<Traverse::Job> ret;
+    for(int i = 0; i < count; i++)
+      ret.push_back({ regularPolygon(CENTER, 2'000, 16 + i * 984 / std::max(count - 1, 1)), static_cast<float>(i * 7 % 180), 5, 10,
+                      Traverse::Entry::TopLeft });
+    return ret;
+  }
+} // namespace
+
+/// Argument is the job count. Same batch as BM_BuildTraverseBatchParallel, planned one job after another.
+static void BM_BuildTraverseBatchSerial(benchmark::State& state)
+{
+  const QList<Traverse::Job> jobs = batchOf(static_cast<int>(state.range(0)));
+  for(auto _ in state)
+    for(const Traverse::Job& job in jobs)
+      benchmark::DoNotOptimize(Traverse::buildTraverse(job.polygon, job.angle, job.spacing, job.turn_around, job.entry));
+  state.SetItemsProcessed(state.iterations() * jobs.size());
+}
+BENCHMARK(BM_BuildTraverseBatchSerial)->Arg(8)->Arg(64)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/// buildTraverseAsync on the global thread pool, wall time since the calling thread only waits.
+static void BM_BuildTraverseBatchParallel(benchmark::State& state)
+{
+  const QList<Traverse::Job> jobs = batchOf(static_cast<int>(state.range(0)));
+  for(auto _ in state)
+  {
+    QFuture<QGeoPath> future = Traverse::buildTraverseAsync(jobs);
+    future.waitForFinished();
+    benchmark::DoNotOptimize(future.resultCount());
+  }
+  state.counters["threads"] = QThreadPool::globalInstance()->maxThreadCount();
+  state.SetItemsProcessed(state.iterations() * jobs.size());
+}
+BENCHMARK(BM_BuildTraverseBatchParallel)->Arg(8)->Arg(64)->Unit(benchmark::kMillisecond)->UseRealTime();
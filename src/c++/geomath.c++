@@ -1,19 +1,142 @@
 #include "geomath.h"
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <QtCore/QPointF>
 #include <QtCore/QDebug>
 #include <QtPositioning/QGeoCoordinate>
+#include "vectormath.h"
 
 __attribute__((constructor)) static void describe() { qInfo() << "<CCL> Library loaded. Version 0.1"; }
 
 constexpr const double MAP_SCALE_RATIO = 156'543.03392;
-constexpr const float EARTH_RADIUS = 6371000;
+constexpr const double EARTH_RADIUS = 6'371'000.0;
 
-constexpr const float TO_RADIANS = M_PI / 180.0f;
-constexpr const float TO_DEGREES = 180.0f / M_PI;
+constexpr const double TO_RADIANS = M_PI / 180.0;
+constexpr const double TO_DEGREES = 180.0 / M_PI;
 
 double logf(double base, double value) noexcept { return (std::log(value) / std::log(base)); }
 
+namespace
+{
+  namespace Vector = CCL::Vector;
+
+  // Kernels below are branch-light and work on plain doubles, so the batch loops
+  // stay free of QGeoCoordinate construction and origin trigonometry.
+  inline void forwardKernel(double latitude, double longitude, double ref_sin_lat, double ref_cos_lat,
+                            double ref_lon_rad, double& north, double& east) noexcept
+  {
+    double lat_rad = latitude * TO_RADIANS;
+    double d_lon = longitude * TO_RADIANS - ref_lon_rad;
+    double sin_lat = std::sin(lat_rad);
+    double cos_lat = std::cos(lat_rad);
+    double sin_d_lon = std::sin(d_lon);
+    double cos_d_lon = std::cos(d_lon);
+
+    double n = ref_cos_lat * sin_lat - ref_sin_lat * cos_lat * cos_d_lon;
+    double e = cos_lat * sin_d_lon;
+
+    // (n, e) is the tangent-plane projection of the unit vector, its length is sin(c) exactly.
+    // atan2 keeps the central angle well-conditioned near the origin, where acos is not.
+    double sin_c = std::hypot(n, e);
+    double cos_c = ref_sin_lat * sin_lat + ref_cos_lat * cos_lat * cos_d_lon;
+    double k = (sin_c < std::numeric_limits<double>::epsilon()) ? 1.0 : (std::atan2(sin_c, cos_c) / sin_c);
+
+    north = k * n * EARTH_RADIUS;
+    east = k * e * EARTH_RADIUS;
+  }
+
+  inline void inverseKernel(double north, double east, double ref_sin_lat, double ref_cos_lat,
+                            double ref_lat_rad, double ref_lon_rad, double& latitude, double& longitude) noexcept
+  {
+    double x = north / EARTH_RADIUS;
+    double y = east / EARTH_RADIUS;
+    double c = std::hypot(x, y);
+    double lat_rad = ref_lat_rad;
+    double lon_rad = ref_lon_rad;
+
+    if(c > std::numeric_limits<double>::epsilon())
+    {
+      double sin_c = std::sin(c);
+      double cos_c = std::cos(c);
+      lat_rad = std::asin(std::clamp(cos_c * ref_sin_lat + x * sin_c * ref_cos_lat / c, -1.0, 1.0));
+      lon_rad = ref_lon_rad + std::atan2(y * sin_c, c * ref_cos_lat * cos_c - x * ref_sin_lat * sin_c);
+      if(lon_rad > M_PI)
+        lon_rad -= 2 * M_PI;
+      else if(lon_rad < -M_PI)
+        lon_rad += 2 * M_PI;
+    }
+
+    latitude = lat_rad * TO_DEGREES;
+    longitude = lon_rad * TO_DEGREES;
+  }
+
+  /**
+   * Vectorizable counterparts of the kernels above for the batch API, built on the
+   * polynomial sin/cos and atan2 of vectormath.h. The batch loops are auto-vectorized.
+   */
+  namespace Batch
+  {
+    inline void forward(double latitude, double longitude, double ref_sin_lat, double ref_cos_lat,
+                        double ref_lon_rad, double& north, double& east) noexcept
+    {
+      double sin_lat, cos_lat, sin_d_lon, cos_d_lon;
+      Vector::sincos(latitude * TO_RADIANS, sin_lat, cos_lat);
+      Vector::sincos(longitude * TO_RADIANS - ref_lon_rad, sin_d_lon, cos_d_lon);
+
+      double n = ref_cos_lat * sin_lat - ref_sin_lat * cos_lat * cos_d_lon;
+      double e = cos_lat * sin_d_lon;
+      double sin_c = std::sqrt(n * n + e * e);
+      double cos_c = ref_sin_lat * sin_lat + ref_cos_lat * cos_lat * cos_d_lon;
+      bool at_origin = sin_c < std::numeric_limits<double>::epsilon();
+      double scale = Vector::atan2(sin_c, cos_c) / std::max(sin_c, std::numeric_limits<double>::epsilon());
+      double k = at_origin ? 1.0 : scale;
+
+      north = k * n * EARTH_RADIUS;
+      east = k * e * EARTH_RADIUS;
+    }
+
+    inline void inverse(double north, double east, double ref_sin_lat, double ref_cos_lat,
+                        double ref_lat_rad, double ref_lon_rad, double& latitude, double& longitude) noexcept
+    {
+      double x = north / EARTH_RADIUS;
+      double y = east / EARTH_RADIUS;
+      double c = std::sqrt(x * x + y * y);
+      bool at_origin = c <= std::numeric_limits<double>::epsilon();
+
+      double sin_c, cos_c;
+      Vector::sincos(c, sin_c, cos_c);
+      double v = cos_c * ref_sin_lat + x * sin_c * ref_cos_lat / std::max(c, std::numeric_limits<double>::epsilon());
+      v = std::min(1.0, std::max(-1.0, v));
+      double lat_rad = Vector::atan2(v, std::sqrt((1 - v) * (1 + v)));
+      double lon_rad = ref_lon_rad + Vector::atan2(y * sin_c, c * ref_cos_lat * cos_c - x * ref_sin_lat * sin_c);
+      lon_rad = (lon_rad > M_PI) ? lon_rad - 2 * M_PI : lon_rad;
+      lon_rad = (lon_rad < -M_PI) ? lon_rad + 2 * M_PI : lon_rad;
+
+      latitude = (at_origin ? ref_lat_rad : lat_rad) * TO_DEGREES;
+      longitude = (at_origin ? ref_lon_rad : lon_rad) * TO_DEGREES;
+    }
+  } // Batch
+
+  CCL_SIMD_CLONES
+  void forwardBatch(size_t count, const double* __restrict latitude, const double* __restrict longitude,
+                    double* __restrict north, double* __restrict east,
+                    double ref_sin_lat, double ref_cos_lat, double ref_lon_rad) noexcept
+  {
+    for(size_t i = 0; i < count; i++)
+      Batch::forward(latitude[i], longitude[i], ref_sin_lat, ref_cos_lat, ref_lon_rad, north[i], east[i]);
+  }
+
+  CCL_SIMD_CLONES
+  void inverseBatch(size_t count, const double* __restrict north, const double* __restrict east,
+                    double* __restrict latitude, double* __restrict longitude,
+                    double ref_sin_lat, double ref_cos_lat, double ref_lat_rad, double ref_lon_rad) noexcept
+  {
+    for(size_t i = 0; i < count; i++)
+      Batch::inverse(north[i], east[i], ref_sin_lat, ref_cos_lat, ref_lat_rad, ref_lon_rad, latitude[i], longitude[i]);
+  }
+} // namespace
+
 namespace CCL
 {
   NEDPoint::NEDPoint()
@@ -28,6 +151,64 @@ namespace CCL
     , z(z)
   {}
 
+  LocalTangentFrame::LocalTangentFrame(const QGeoCoordinate& origin)
+    : LocalTangentFrame(origin.latitude(), origin.longitude(), origin.altitude())
+  {}
+
+  LocalTangentFrame::LocalTangentFrame(double latitude, double longitude, double altitude)
+    : m_lat_rad(latitude * TO_RADIANS)
+    , m_lon_rad(longitude * TO_RADIANS)
+    , m_altitude(altitude)
+    , m_sin_lat(std::sin(latitude * TO_RADIANS))
+    , m_cos_lat(std::cos(latitude * TO_RADIANS))
+  {}
+
+  NEDPoint LocalTangentFrame::toNED(const QGeoCoordinate& coord) const noexcept
+  {
+    double north, east;
+    forwardKernel(coord.latitude(), coord.longitude(), m_sin_lat, m_cos_lat, m_lon_rad, north, east);
+    return { static_cast<float>(north), static_cast<float>(east), static_cast<float>(-(coord.altitude() - m_altitude)) };
+  }
+
+  QGeoCoordinate LocalTangentFrame::toGeo(const NEDPoint& ned) const noexcept
+  {
+    double latitude, longitude;
+    inverseKernel(ned.x, ned.y, m_sin_lat, m_cos_lat, m_lat_rad, m_lon_rad, latitude, longitude);
+    return { latitude, longitude, -ned.z + m_altitude };
+  }
+
+  void LocalTangentFrame::toNED(size_t count, const double* latitude, const double* longitude, const double* altitude,
+                                double* north, double* east, double* down) const noexcept
+  {
+    forwardBatch(count, latitude, longitude, north, east, m_sin_lat, m_cos_lat, m_lon_rad);
+
+    if(down == nullptr)
+      return;
+    if(altitude == nullptr)
+      std::fill(down, down + count, 0.0);
+    else
+      for(size_t i = 0; i < count; i++)
+        down[i] = m_altitude - altitude[i];
+  }
+
+  void LocalTangentFrame::toGeo(size_t count, const double* north, const double* east, const double* down,
+                                double* latitude, double* longitude, double* altitude) const noexcept
+  {
+    inverseBatch(count, north, east, latitude, longitude, m_sin_lat, m_cos_lat, m_lat_rad, m_lon_rad);
+
+    if(altitude == nullptr)
+      return;
+    if(down == nullptr)
+      std::fill(altitude, altitude + count, m_altitude);
+    else
+      for(size_t i = 0; i < count; i++)
+        altitude[i] = m_altitude - down[i];
+  }
+
+  double LocalTangentFrame::latitude() const noexcept { return m_lat_rad * TO_DEGREES; }
+  double LocalTangentFrame::longitude() const noexcept { return m_lon_rad * TO_DEGREES; }
+  double LocalTangentFrame::altitude() const noexcept { return m_altitude; }
+
   double mqiZoomLevel(double latitude, float meters_per_pixel) noexcept
   {
     if(not meters_per_pixel)
@@ -45,39 +226,11 @@ namespace CCL
   {
     if(coord == origin)
       return {};
-
-    double sin_lat = std::sin(TO_RADIANS * coord.latitude());
-    double cos_lat = std::cos(TO_RADIANS * coord.latitude());
-    double cos_d_lon = std::cos(TO_RADIANS * coord.longitude() - TO_RADIANS * origin.longitude());
-    double ref_sin_lat = std::sin(TO_RADIANS * origin.latitude());
-    double ref_cos_lat = std::cos(TO_RADIANS * origin.latitude());
-
-    double c = std::acos(ref_sin_lat * sin_lat + ref_cos_lat * cos_lat * cos_d_lon);
-    double k = (std::fabs(c) < std::numeric_limits<double>::epsilon()) ? 1.0 : (c / sin(c));
-
-    return { static_cast<float>(k * (ref_cos_lat * sin_lat - ref_sin_lat * cos_lat * cos_d_lon) * EARTH_RADIUS),
-             static_cast<float>(k * cos_lat * sin(TO_RADIANS * coord.longitude() - TO_RADIANS * origin.longitude()) * EARTH_RADIUS),
-             static_cast<float>(-(coord.altitude() - origin.altitude())) };
+    return LocalTangentFrame(origin).toNED(coord);
   }
 
   QGeoCoordinate ned2geo(const NEDPoint& ned, const QGeoCoordinate& origin) noexcept
   {
-    double c = std::hypot(ned.x / EARTH_RADIUS, ned.y / EARTH_RADIUS);
-    double ref_sin_lat = std::sin(origin.latitude() * TO_RADIANS);
-    double ref_cos_lat = std::cos(origin.latitude() * TO_RADIANS);
-    double lat_rad, lon_rad;
-
-    if(std::fabs(c) > std::numeric_limits<double>::epsilon())
-    {
-      lat_rad = asin(std::cos(c) * ref_sin_lat + (ned.x / EARTH_RADIUS * std::sin(c) * ref_cos_lat) / c);
-      lon_rad = (origin.longitude() * TO_RADIANS + atan2(ned.y / EARTH_RADIUS * std::sin(c),
-                                                         c * ref_cos_lat * std::cos(c) - ned.x / EARTH_RADIUS * ref_sin_lat * std::sin(c)));
-    }
-    else
-    {
-      lat_rad = origin.latitude() * TO_RADIANS;
-      lon_rad = origin.longitude() * TO_RADIANS;
-    }
-    return { TO_DEGREES * lat_rad, TO_DEGREES * lon_rad, -ned.z + origin.altitude() };
+    return LocalTangentFrame(origin).toGeo(ned);
   }
 } // CCL
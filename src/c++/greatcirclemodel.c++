@@ -0,0 +1,118 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "greatcirclemodel.h"
+#include <algorithm>
+
+namespace CCL
+{
+  GreatCircleModel::GreatCircleModel(QObject* parent)
+    : QAbstractListModel(parent)
+    , m_first()
+    , m_second()
+    , m_spacing(10'000)
+    , m_max_error(0)
+    , m_arc(m_first, m_second)
+    , m_count(0)
+  {}
+
+  QGeoCoordinate GreatCircleModel::coordinateAt(int index) const
+  {
+    if(index < 0 or index >= m_count)
+      return {};
+    if(index == 0)
+      return m_first;
+    if(index == m_count - 1)
+      return m_second;
+    return m_arc.at(static_cast<double>(index) / (m_count - 1));
+  }
+
+  int GreatCircleModel::rowCount(const QModelIndex& parent) const { return parent.isValid() ? 0 : m_count; }
+
+  QVariant GreatCircleModel::data(const QModelIndex& index, int role) const
+  {
+    QGeoCoordinate coordinate = coordinateAt(index.row());
+    if(not coordinate.isValid())
+      return {};
+
+    switch(role)
+    {
+      case CoordinateRole: return QVariant::fromValue(coordinate);
+      case LatitudeRole: return coordinate.latitude();
+      case LongitudeRole: return coordinate.longitude();
+      default: return {};
+    }
+  }
+
+  QHash<int, QByteArray> GreatCircleModel::roleNames() const
+  {
+    return { { CoordinateRole, "coordinate" }, { LatitudeRole, "latitude" }, { LongitudeRole, "longitude" } };
+  }
+
+  void GreatCircleModel::rebuild()
+  {
+    int count = 0;
+    GreatCircle arc(m_first, m_second);
+    if(m_first.isValid() and m_second.isValid())
+    {
+      size_t points = arc.countForSpacing(m_spacing);
+      if(m_max_error > 0)
+        points = std::max(points, arc.countForError(m_max_error));
+      count = static_cast<int>(points);
+    }
+
+    const int previous_count = m_count;
+    const double previous_length = this->length();
+    beginResetModel();
+    m_arc = arc;
+    m_count = count;
+    endResetModel();
+    if(m_count != previous_count)
+      emit countChanged();
+    if(this->length() != previous_length)
+      emit lengthChanged();
+  }
+
+  QGeoCoordinate GreatCircleModel::first() const { return m_first; }
+  void GreatCircleModel::setFirst(const QGeoCoordinate& x) {
+    if(x == m_first)
+      return;
+    m_first = x;
+    emit firstChanged();
+    this->rebuild();
+  }
+
+  QGeoCoordinate GreatCircleModel::second() const { return m_second; }
+  void GreatCircleModel::setSecond(const QGeoCoordinate& x) {
+    if(x == m_second)
+      return;
+    m_second = x;
+    emit secondChanged();
+    this->rebuild();
+  }
+
+  double GreatCircleModel::spacing() const { return m_spacing; }
+  void GreatCircleModel::setSpacing(double x) {
+    if(x == m_spacing)
+      return;
+    m_spacing = x;
+    emit spacingChanged();
+    this->rebuild();
+  }
+
+  double GreatCircleModel::maxError() const { return m_max_error; }
+  void GreatCircleModel::setMaxError(double x) {
+    if(x == m_max_error)
+      return;
+    m_max_error = x;
+    emit maxErrorChanged();
+    this->rebuild();
+  }
+
+  int GreatCircleModel::count() const { return m_count; }
+  double GreatCircleModel::length() const { return m_count > 0 ? m_arc.length() : 0; }
+} // CCL
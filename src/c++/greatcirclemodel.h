@@ -0,0 +1,73 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <QtCore/QAbstractListModel>
+#include <QtPositioning/QGeoCoordinate>
+#include "orthodrom.h"
+
+namespace CCL
+{
+  /**
+   * Lazy QML view of a great circle arc: rows are computed in data() on request,
+   * nothing is stored per point. Point count comes from spacing or, when set,
+   * from the maximum chord error (meters), whichever needs more points.
+   */
+  class GreatCircleModel : public QAbstractListModel
+  {
+    Q_OBJECT
+    Q_PROPERTY(QGeoCoordinate first READ first WRITE setFirst NOTIFY firstChanged FINAL)
+    Q_PROPERTY(QGeoCoordinate second READ second WRITE setSecond NOTIFY secondChanged FINAL)
+    Q_PROPERTY(double spacing READ spacing WRITE setSpacing NOTIFY spacingChanged FINAL)
+    Q_PROPERTY(double maxError READ maxError WRITE setMaxError NOTIFY maxErrorChanged FINAL)
+    Q_PROPERTY(int count READ count NOTIFY countChanged STORED false FINAL)
+    Q_PROPERTY(double length READ length NOTIFY lengthChanged STORED false FINAL)
+
+    public:
+      enum Roles
+      {
+        CoordinateRole = Qt::UserRole + 1,
+        LatitudeRole,
+        LongitudeRole
+      };
+
+      explicit GreatCircleModel(QObject* parent = nullptr);
+
+      [[nodiscard]] QGeoCoordinate first() const;   void setFirst(const QGeoCoordinate&);
+      [[nodiscard]] QGeoCoordinate second() const;  void setSecond(const QGeoCoordinate&);
+      [[nodiscard]] double spacing() const;         void setSpacing(double);
+      [[nodiscard]] double maxError() const;        void setMaxError(double);
+      [[nodiscard]] int count() const;
+      [[nodiscard]] double length() const;
+
+      [[nodiscard]] Q_INVOKABLE QGeoCoordinate coordinateAt(int index) const;
+
+      [[nodiscard]] int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+      [[nodiscard]] QVariant data(const QModelIndex& index, int role) const override;
+      [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
+
+    signals:
+      void firstChanged();
+      void secondChanged();
+      void spacingChanged();
+      void maxErrorChanged();
+      void countChanged();
+      void lengthChanged();
+
+    private:
+      void rebuild();
+
+    private:
+      QGeoCoordinate m_first;
+      QGeoCoordinate m_second;
+      double m_spacing;
+      double m_max_error;
+      GreatCircle m_arc;
+      int m_count;
+  };
+} // CCL
@@ -0,0 +1,188 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "metrics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+
+#define in :
+
+namespace
+{
+  using namespace CCL::Metrics;
+
+  #if defined(CCL_METRICS_ENABLED)
+  constexpr const size_t BUCKETS = 32;
+
+  struct HistogramData
+  {
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+  };
+
+  // Zero-initialized statics, all updates are relaxed atomics: no locks on the hot paths.
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> counters;
+  std::array<std::atomic<int64_t>, static_cast<size_t>(Gauge::Count)> gauges;
+  std::array<HistogramData, static_cast<size_t>(Histogram::Count)> histograms;
+
+  size_t bucketOf(uint64_t value) noexcept
+  {
+    size_t ret = 0;
+    while(value > 1 and ret < BUCKETS - 1)
+    {
+      value >>= 1;
+      ret++;
+    }
+    return ret;
+  }
+
+  /// Upper bound of the bucket holding the given quantile, capped by the largest value recorded.
+  uint64_t quantile(const HistogramData& data, uint64_t count, double q) noexcept
+  {
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(count));
+    uint64_t max = data.max.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for(size_t i = 0; i + 1 < BUCKETS; i++)
+    {
+      seen += data.buckets[i].load(std::memory_order_relaxed);
+      if(seen > rank)
+        return std::min((uint64_t(1) << (i + 1)) - 1, max);
+    }
+
+    // The last bucket is open-ended.
+    return max;
+  }
+
+  const char* const COUNTER_NAMES[] = { "tileRequests", "tileFailures", "tileRetries", "tileCancellations", "tileBytes",
+                                        "tileCacheHits", "tileCacheMisses" };
+  const char* const GAUGE_NAMES[] = { "tileQueueDepth", "tilesInFlight" };
+  const char* const HISTOGRAM_NAMES[] = { "tileLatency", "diskWrite", "traverseProjection", "traverseTransects",
+                                          "traverseIntersection", "traverseReprojection" };
+  static_assert(std::size(COUNTER_NAMES) == static_cast<size_t>(Counter::Count));
+  static_assert(std::size(GAUGE_NAMES) == static_cast<size_t>(Gauge::Count));
+  static_assert(std::size(HISTOGRAM_NAMES) == static_cast<size_t>(Histogram::Count));
+  #endif
+} // namespace
+
+namespace CCL::Metrics
+{
+  void add(Counter counter, uint64_t value) noexcept
+  {
+    #if defined(CCL_METRICS_ENABLED)
+    counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    #else
+    Q_UNUSED(counter)
+    Q_UNUSED(value)
+    #endif
+  }
+
+  void set(Gauge gauge, int64_t value) noexcept
+  {
+    #if defined(CCL_METRICS_ENABLED)
+    gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+    #else
+    Q_UNUSED(gauge)
+    Q_UNUSED(value)
+    #endif
+  }
+
+  void record(Histogram histogram, uint64_t microseconds) noexcept
+  {
+    #if defined(CCL_METRICS_ENABLED)
+    HistogramData& data = histograms[static_cast<size_t>(histogram)];
+    data.buckets[bucketOf(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    data.count.fetch_add(1, std::memory_order_relaxed);
+    data.sum.fetch_add(microseconds, std::memory_order_relaxed);
+    uint64_t max = data.max.load(std::memory_order_relaxed);
+    while(microseconds > max and not data.max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+      ;
+    #else
+    Q_UNUSED(histogram)
+    Q_UNUSED(microseconds)
+    #endif
+  }
+
+  void reset() noexcept
+  {
+    #if defined(CCL_METRICS_ENABLED)
+    for(auto& counter in counters)
+      counter.store(0, std::memory_order_relaxed);
+    for(auto& data in histograms)
+    {
+      for(auto& bucket in data.buckets)
+        bucket.store(0, std::memory_order_relaxed);
+      data.count.store(0, std::memory_order_relaxed);
+      data.sum.store(0, std::memory_order_relaxed);
+      data.max.store(0, std::memory_order_relaxed);
+    }
+    #endif
+  }
+
+  QVariantMap snapshot()
+  {
+    QVariantMap ret;
+    ret.insert("enabled", enabled());
+
+    #if defined(CCL_METRICS_ENABLED)
+    QVariantMap counter_map;
+    for(size_t i = 0; i < counters.size(); i++)
+      counter_map.insert(COUNTER_NAMES[i], static_cast<qulonglong>(counters[i].load(std::memory_order_relaxed)));
+    ret.insert("counters", counter_map);
+
+    QVariantMap gauge_map;
+    for(size_t i = 0; i < gauges.size(); i++)
+      gauge_map.insert(GAUGE_NAMES[i], static_cast<qlonglong>(gauges[i].load(std::memory_order_relaxed)));
+    ret.insert("gauges", gauge_map);
+
+    QVariantMap histogram_map;
+    for(size_t i = 0; i < histograms.size(); i++)
+    {
+      const HistogramData& data = histograms[i];
+      uint64_t count = data.count.load(std::memory_order_relaxed);
+      uint64_t sum = data.sum.load(std::memory_order_relaxed);
+      histogram_map.insert(HISTOGRAM_NAMES[i], QVariantMap {
+        { "count", static_cast<qulonglong>(count) },
+        { "sum", static_cast<qulonglong>(sum) },
+        { "mean", count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0 },
+        { "max", static_cast<qulonglong>(data.max.load(std::memory_order_relaxed)) },
+        { "p50", static_cast<qulonglong>(quantile(data, count, 0.5)) },
+        { "p90", static_cast<qulonglong>(quantile(data, count, 0.9)) },
+        { "p99", static_cast<qulonglong>(quantile(data, count, 0.99)) }
+      });
+    }
+    ret.insert("histograms", histogram_map);
+    #endif
+
+    return ret;
+  }
+
+  ScopedTimer::ScopedTimer(Histogram histogram) noexcept
+    : m_histogram(histogram)
+    , m_start(std::chrono::steady_clock::now())
+  {}
+
+  ScopedTimer::~ScopedTimer()
+  {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+    record(m_histogram, static_cast<uint64_t>(elapsed.count()));
+  }
+} // CCL::Metrics
+
+namespace CCL
+{
+  MetricsProvider::MetricsProvider(QObject* parent)
+    : QObject(parent)
+  {}
+
+  bool MetricsProvider::enabled() { return Metrics::enabled(); }
+  QVariantMap MetricsProvider::snapshot() const { return Metrics::snapshot(); }
+  void MetricsProvider::reset() { Metrics::reset(); }
+} // CCL
@@ -0,0 +1,112 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <QtCore/QObject>
+#include <QtCore/QVariantMap>
+
+/**
+ * Opt-in runtime instrumentation. Build with CCL_METRICS_ENABLED to collect;
+ * otherwise every CCL_METRIC_* macro expands to nothing and snapshot() only
+ * reports that metrics are disabled.
+ */
+namespace CCL::Metrics
+{
+  enum class Counter
+  {
+    TileRequests,
+    TileFailures,       ///< tiles given up on: permanent errors and exhausted retries
+    TileRetries,        ///< failed attempts scheduled for another try
+    TileCancellations,  ///< requests aborted because no job wants the tile anymore
+    TileBytes,
+    TileCacheHits,
+    TileCacheMisses,
+    Count
+  };
+
+  enum class Gauge
+  {
+    TileQueueDepth,
+    TilesInFlight,
+    Count
+  };
+
+  /// Durations in microseconds, bucketed by powers of two.
+  enum class Histogram
+  {
+    TileLatency,
+    DiskWrite,
+    TraverseProjection,
+    TraverseTransects,
+    TraverseIntersection,
+    TraverseReprojection,
+    Count
+  };
+
+  [[nodiscard]] constexpr bool enabled() noexcept
+  {
+    #if defined(CCL_METRICS_ENABLED)
+    return true;
+    #else
+    return false;
+    #endif
+  }
+
+  void add(Counter counter, uint64_t value = 1) noexcept;
+  void set(Gauge gauge, int64_t value) noexcept;
+  void record(Histogram histogram, uint64_t microseconds) noexcept;
+  /// Clears counters and histograms. Gauges hold current levels, not totals, and are kept:
+  /// zeroing them would report an empty queue until the next set().
+  void reset() noexcept;
+  [[nodiscard]] QVariantMap snapshot();
+
+  class ScopedTimer
+  {
+    public:
+      explicit ScopedTimer(Histogram histogram) noexcept;
+      ~ScopedTimer();
+
+    private:
+      Histogram m_histogram;
+      std::chrono::steady_clock::time_point m_start;
+  };
+} // CCL::Metrics
+
+namespace CCL
+{
+  /// QML facade over CCL::Metrics, registered as the CCL.Metrics / CCLMetrics singleton.
+  class MetricsProvider : public QObject
+  {
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ enabled CONSTANT FINAL)
+
+    public:
+      explicit MetricsProvider(QObject* parent = nullptr);
+
+      [[nodiscard]] static bool enabled();
+      [[nodiscard]] Q_INVOKABLE QVariantMap snapshot() const;
+      Q_INVOKABLE void reset();
+  };
+} // CCL
+
+#if defined(CCL_METRICS_ENABLED)
+#define CCL_METRICS_CONCAT_(a, b) a##b
+#define CCL_METRICS_CONCAT(a, b) CCL_METRICS_CONCAT_(a, b)
+#define CCL_METRIC_ADD(counter, value) CCL::Metrics::add(CCL::Metrics::Counter::counter, value)
+#define CCL_METRIC_SET(gauge, value) CCL::Metrics::set(CCL::Metrics::Gauge::gauge, value)
+#define CCL_METRIC_RECORD(histogram, microseconds) CCL::Metrics::record(CCL::Metrics::Histogram::histogram, microseconds)
+#define CCL_METRIC_SCOPE(histogram) \
+  CCL::Metrics::ScopedTimer CCL_METRICS_CONCAT(ccl_metric_scope_, __LINE__)(CCL::Metrics::Histogram::histogram)
+#else
+#define CCL_METRIC_ADD(counter, value) static_cast<void>(0)
+#define CCL_METRIC_SET(gauge, value) static_cast<void>(0)
+#define CCL_METRIC_RECORD(histogram, microseconds) static_cast<void>(0)
+#define CCL_METRIC_SCOPE(histogram) static_cast<void>(0)
+#endif
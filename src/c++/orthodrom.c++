@@ -1,29 +1,179 @@
 #include "orthodrom.h"
+#include <algorithm>
 #include <cmath>
 #include <QtMath>
+#include "vectormath.h"
 
 using namespace CCL;
 
 constexpr const double d2r = M_PI / 180;
+constexpr const double EARTH_RADIUS = 6'371'000.0;
 
+// Points per slerpBatch call, keeps the index within int.
+constexpr const size_t BATCH = size_t(1) << 30;
+
+namespace
+{
+    void toUnitVector(const QGeoCoordinate& coord, double* out) noexcept
+    {
+        double lat = coord.latitude() * d2r;
+        double lon = coord.longitude() * d2r;
+        out[0] = std::cos(lat) * std::cos(lon);
+        out[1] = std::cos(lat) * std::sin(lon);
+        out[2] = std::sin(lat);
+    }
+
+    /**
+     * Weights of every point come from its own index, iterations are independent and the loop
+     * vectorizes. The index is an int: 64-bit integer to double conversion has no SSE2/AVX2 form.
+     */
+    CCL_SIMD_CLONES
+    void slerpBatch(int count, size_t first, double step, const double* origin, const double* tangent,
+                    double* __restrict latitude, double* __restrict longitude) noexcept
+    {
+        const double base = static_cast<double>(first);
+        const double o0 = origin[0], o1 = origin[1], o2 = origin[2];
+        const double t0 = tangent[0], t1 = tangent[1], t2 = tangent[2];
+        for(int k = 0; k < count; k++)
+        {
+            double s, c;
+            Vector::sincos((base + static_cast<double>(k)) * step, s, c);
+            double x = o0 * c + t0 * s;
+            double y = o1 * c + t1 * s;
+            double z = o2 * c + t2 * s;
+            latitude[k] = Vector::atan2(z, std::sqrt(x * x + y * y)) / d2r;
+            longitude[k] = Vector::atan2(y, x) / d2r;
+        }
+    }
+} // namespace
+
+GreatCircle::GreatCircle(const QGeoCoordinate& first, const QGeoCoordinate& second)
+    : m_first(first)
+    , m_second(second)
+{
+    double b[3];
+    toUnitVector(first, m_origin);
+    toUnitVector(second, b);
+
+    double dot = m_origin[0] * b[0] + m_origin[1] * b[1] + m_origin[2] * b[2];
+    for(int i = 0; i < 3; i++)
+        m_tangent[i] = b[i] - dot * m_origin[i];
+    double norm = std::sqrt(m_tangent[0] * m_tangent[0] + m_tangent[1] * m_tangent[1] + m_tangent[2] * m_tangent[2]);
+
+    if(norm < 1e-12)
+    {
+        // Coincident or antipodal endpoints: fall back to the local north direction of the first point.
+        double lat = first.latitude() * d2r;
+        double lon = first.longitude() * d2r;
+        m_tangent[0] = -std::sin(lat) * std::cos(lon);
+        m_tangent[1] = -std::sin(lat) * std::sin(lon);
+        m_tangent[2] = std::cos(lat);
+        norm = 0;
+    }
+    else
+        for(double& component : m_tangent)
+            component /= norm;
+
+    m_angle = std::atan2(norm, dot);
+}
+
+double GreatCircle::angle() const noexcept { return m_angle; }
+double GreatCircle::length() const noexcept { return m_angle * EARTH_RADIUS; }
+
+QGeoCoordinate GreatCircle::at(double fraction) const noexcept
+{
+    double c = std::cos(fraction * m_angle);
+    double s = std::sin(fraction * m_angle);
+    double x = m_origin[0] * c + m_tangent[0] * s;
+    double y = m_origin[1] * c + m_tangent[1] * s;
+    double z = m_origin[2] * c + m_tangent[2] * s;
+    return { std::atan2(z, std::hypot(x, y)) / d2r, std::atan2(y, x) / d2r };
+}
+
+/// Latitude where the whole great circle, not only the arc between the endpoints, crosses the meridian.
+double GreatCircle::latitudeAt(double longitude) const noexcept
+{
+    double normal[3] = { m_origin[1] * m_tangent[2] - m_origin[2] * m_tangent[1],
+                         m_origin[2] * m_tangent[0] - m_origin[0] * m_tangent[2],
+                         m_origin[0] * m_tangent[1] - m_origin[1] * m_tangent[0] };
+    double lon = longitude * d2r;
+    return std::atan(-(normal[0] * std::cos(lon) + normal[1] * std::sin(lon)) / normal[2]) / d2r;
+}
+
+size_t GreatCircle::countForSpacing(double meters) const noexcept
+{
+    if(meters <= 0)
+        return 2;
+    return std::max<size_t>(1, static_cast<size_t>(std::ceil(length() / meters))) + 1;
+}
+
+size_t GreatCircle::countForError(double meters) const noexcept { return this->countForAngularError(meters / EARTH_RADIUS); }
+
+size_t GreatCircle::countForAngularError(double radians) const noexcept
+{
+    if(radians <= 0 or radians >= 1)
+        return 2;
+    double max_step = 2 * std::acos(1 - radians);
+    return std::max<size_t>(1, static_cast<size_t>(std::ceil(m_angle / max_step))) + 1;
+}
+
+void GreatCircle::sample(size_t count, double* latitude, double* longitude) const noexcept
+{
+    if(count == 0)
+        return;
+
+    double step = (count > 1) ? m_angle / static_cast<double>(count - 1) : 0;
+    for(size_t first = 0; first < count; first += BATCH)
+    {
+        int size = static_cast<int>(std::min(BATCH, count - first));
+        slerpBatch(size, first, step, m_origin, m_tangent, latitude + first, longitude + first);
+    }
+
+    latitude[0] = m_first.latitude();
+    longitude[0] = m_first.longitude();
+    if(count > 1)
+    {
+        latitude[count - 1] = m_second.latitude();
+        longitude[count - 1] = m_second.longitude();
+    }
+}
+
+void GreatCircle::sample(size_t count, vector<QGeoCoordinate>& out) const
+{
+    vector<double> latitude(count), longitude(count);
+    this->sample(count, latitude.data(), longitude.data());
+
+    out.clear();
+    out.reserve(count);
+    for(size_t i = 0; i < count; i++)
+        out.emplace_back(latitude[i], longitude[i]);
+}
+
+QGeoPath GreatCircle::path(size_t count) const
+{
+    vector<QGeoCoordinate> points;
+    this->sample(count, points);
+    return QGeoPath(QList<QGeoCoordinate>(points.cbegin(), points.cend()));
+}
+
+// The arc runs from second towards first, the historical order of the path.
 Orthodrom::Orthodrom(const QGeoCoordinate& first, const QGeoCoordinate& second)
     : first(first)
     , second(second)
+    , arc(second, first)
 {
-    a1 = qTan(qDegreesToRadians(first.latitude())) / qSin(qDegreesToRadians(second.longitude() - first.longitude()));
-    a2 = qTan(qDegreesToRadians(second.latitude())) / qSin(qDegreesToRadians(second.longitude() - first.longitude()));
-
     this->distribute(10);
 }
 
 Orthodrom::Orthodrom()
     : first({0, 0})
     , second({0, 0})
+    , arc(second, first)
 {}
 
 QList<QVariant> Orthodrom::get() const noexcept
 {
-    if(sin(first.longitude() - second.longitude()))
+    if(not path.isEmpty())
         return path;
 
     return { QVariant::fromValue(first), QVariant::fromValue(second) };
@@ -33,50 +183,21 @@ void Orthodrom::set(const QGeoCoordinate& a, const QGeoCoordinate& b) noexcept
 {
     first = a;
     second = b;
-
-    a1 = qTan(qDegreesToRadians(first.latitude())) / qSin(qDegreesToRadians(second.longitude() - first.longitude()));
-    a2 = qTan(qDegreesToRadians(second.latitude())) / qSin(qDegreesToRadians(second.longitude() - first.longitude()));
+    arc = GreatCircle(second, first);
 
     this->distribute(10);
 }
 
-double Orthodrom::latitudeAt(double longitude) const noexcept
-{
-    double angle = qAtan(a2 * qSin(qDegreesToRadians(longitude - first.longitude()))
-                         + a1 * qSin(qDegreesToRadians(second.longitude() - longitude)));
-
-    return qRadiansToDegrees(angle);
-}
+double Orthodrom::latitudeAt(double longitude) const noexcept { return arc.latitudeAt(longitude); }
 
+/// Spacing is in kilometers.
 void Orthodrom::distribute(uint16_t spacing) noexcept
 {
-    if (qIsNaN(a1) or qIsNaN(a2))
-        return;
-    path.clear();
-    path << QVariant::fromValue(second);
-    double az = first.azimuthTo(second);
-    double d = distance();
-
-    while (d - spacing > 0)
-    {
-        QGeoCoordinate tmp = first.atDistanceAndAzimuth(d * 1000, az);
-        path << QVariant::fromValue(QGeoCoordinate(latitudeAt(tmp.longitude()), tmp.longitude(), 0));
-        d -= spacing;
-    }
-
-    QGeoCoordinate tmp = first.atDistanceAndAzimuth(d, az);
-    if(tmp.longitude() - second.longitude() != 0)
-        path << QVariant::fromValue(QGeoCoordinate(latitudeAt(tmp.longitude()), tmp.longitude(), 0));
-    else
-        path << QVariant::fromValue(tmp);
-}
-
-double Orthodrom::distance() const noexcept
-{
-    double tmp = qSin(qDegreesToRadians(first.latitude())) * qSin(qDegreesToRadians(second.latitude())) +
-                 qCos(qDegreesToRadians(first.latitude())) * qCos(qDegreesToRadians(second.latitude()))
-                     * qCos(qDegreesToRadians(second.longitude() - first.longitude()));
-    double angle = qRadiansToDegrees(qAcos(tmp)) * 60;
+    vector<QGeoCoordinate> points;
+    arc.sample(arc.countForSpacing(spacing * 1000.0), points);
 
-    return angle * 1.853;
+    path.clear();
+    path.reserve(static_cast<int>(points.size()));
+    for(const QGeoCoordinate& point : points)
+        path << QVariant::fromValue(point);
 }
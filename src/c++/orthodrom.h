@@ -7,11 +7,51 @@
 
 #pragma once
 
+#include <cstddef>
+#include <vector>
 #include <QtCore/QVariantList>
 #include <QtPositioning/QGeoCoordinate>
+#include <QtPositioning/QGeoPath>
+
+using std::vector;
 
 namespace CCL
 {
+    /**
+     * Great circle arc between two coordinates, sampled by spherical linear interpolation.
+     * Points are rotated from the first endpoint's unit vector towards the tangent of the arc.
+     * Batch sampling evaluates each point's weights from its index with the polynomial kernels
+     * of vectormath.h, so the loop carries no state and no libm calls and is vectorized.
+     * Working on unit vectors keeps antimeridian and polar crossings continuous. Antipodal
+     * endpoints do not define a unique arc, the one through the first point's meridian is used.
+     */
+    class GreatCircle
+    {
+        public:
+            GreatCircle(const QGeoCoordinate& first, const QGeoCoordinate& second);
+
+            [[nodiscard]] double angle() const noexcept;
+            [[nodiscard]] double length() const noexcept;
+            [[nodiscard]] QGeoCoordinate at(double fraction) const noexcept;
+            [[nodiscard]] double latitudeAt(double longitude) const noexcept;
+
+            /// Point counts including both endpoints. Errors are the largest deviation of a chord from the
+            /// arc (its sagitta), in meters or as the central angle in radians, meters / EARTH_RADIUS.
+            [[nodiscard]] size_t countForSpacing(double meters) const noexcept;
+            [[nodiscard]] size_t countForError(double meters) const noexcept;
+            [[nodiscard]] size_t countForAngularError(double radians) const noexcept;
+
+            void sample(size_t count, double* latitude, double* longitude) const noexcept;
+            void sample(size_t count, vector<QGeoCoordinate>& out) const;
+            [[nodiscard]] QGeoPath path(size_t count) const;
+
+        private:
+            double m_origin[3];
+            double m_tangent[3];
+            double m_angle;
+            QGeoCoordinate m_first, m_second;
+    };
+
     class Orthodrom
     {
         public:
@@ -25,11 +65,10 @@ namespace CCL
 
         private:
             void distribute(uint16_t spacing) noexcept;
-            double distance() const noexcept;
 
         private:
-            double a1, a2;
             QGeoCoordinate first, second;
+            GreatCircle arc;
             QList<QVariant> path;
     };
 } // CCL
@@ -9,6 +9,8 @@
 #include <QtQml/qqml.h>
 #include "CCL/TileLoader"
 #include "CCL/GoogleMapsProvider"
+#include "CCL/GreatCircleModel"
+#include "CCL/Metrics"
 
 namespace CCL
 {
@@ -16,6 +18,14 @@ namespace CCL
   {
     qmlRegisterModule("CCL.Tiles", 1, 0);
 
+    qmlRegisterModule("CCL.Geo", 1, 0);
+    qmlRegisterType<GreatCircleModel>("CCL.Geo", 1, 0, "CCLGreatCircle");
+
+    qmlRegisterModule("CCL.Metrics", 1, 0);
+    qmlRegisterSingletonType<MetricsProvider>("CCL.Metrics", 1, 0, "CCLMetrics", [](QQmlEngine*, QJSEngine*) -> QObject* {
+      return new MetricsProvider;
+    });
+
     qmlRegisterModule("CCL.Extras", 1, 0);
     qmlRegisterType<GoogleMapsProvider>("CCL.Extras", 1, 0, "CCLGoogleMapsProvider");
   }
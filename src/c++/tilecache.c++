@@ -0,0 +1,149 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "tilecache.h"
+#include <QtCore/QMutexLocker>
+
+#define in :
+
+namespace CCL
+{
+  TileCache::TileCache(qint64 budget)
+    : m_budget(budget)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+  {}
+
+  QByteArray TileCache::find(TileKey key)
+  {
+    Shard& shard = shardFor(key);
+    QMutexLocker lock(&shard.mutex);
+    auto it = shard.index.constFind(key);
+    if(it == shard.index.cend())
+    {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return {};
+    }
+
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    shard.lru.splice(shard.lru.begin(), shard.lru, it.value());
+    return it.value()->second;
+  }
+
+  bool TileCache::contains(TileKey key) const
+  {
+    const Shard& shard = shardFor(key);
+    QMutexLocker lock(&shard.mutex);
+    return shard.index.contains(key);
+  }
+
+  void TileCache::insert(TileKey key, const QByteArray& data)
+  {
+    qint64 budget = m_budget.load(std::memory_order_relaxed) / SHARD_COUNT;
+    if(costOf(data) > budget)
+      return;
+
+    // Stored non-null so a missing tile reads back distinguishable from a cache miss.
+    QByteArray value = data.isEmpty() ? QByteArray("") : data;
+    Shard& shard = shardFor(key);
+    QMutexLocker lock(&shard.mutex);
+    auto it = shard.index.find(key);
+    if(it != shard.index.end())
+    {
+      QByteArray& previous = it.value()->second;
+      shard.bytes += costOf(value) - costOf(previous);
+      shard.missing += (value.isEmpty() ? 1 : 0) - (previous.isEmpty() ? 1 : 0);
+      previous = value;
+      shard.lru.splice(shard.lru.begin(), shard.lru, it.value());
+    }
+    else
+    {
+      shard.lru.emplace_front(key, value);
+      shard.index.insert(key, shard.lru.begin());
+      shard.bytes += costOf(value);
+      shard.missing += value.isEmpty() ? 1 : 0;
+    }
+
+    this->evict(shard, budget);
+  }
+
+  void TileCache::remove(TileKey key)
+  {
+    Shard& shard = shardFor(key);
+    QMutexLocker lock(&shard.mutex);
+    auto it = shard.index.find(key);
+    if(it == shard.index.end())
+      return;
+
+    shard.bytes -= costOf(it.value()->second);
+    shard.missing -= it.value()->second.isEmpty() ? 1 : 0;
+    shard.lru.erase(it.value());
+    shard.index.erase(it);
+  }
+
+  void TileCache::clear()
+  {
+    for(Shard& shard in m_shards)
+    {
+      QMutexLocker lock(&shard.mutex);
+      shard.lru.clear();
+      shard.index.clear();
+      shard.bytes = 0;
+      shard.missing = 0;
+    }
+  }
+
+  qint64 TileCache::budget() const noexcept { return m_budget.load(std::memory_order_relaxed); }
+  void TileCache::setBudget(qint64 budget)
+  {
+    m_budget.store(budget, std::memory_order_relaxed);
+    for(Shard& shard in m_shards)
+    {
+      QMutexLocker lock(&shard.mutex);
+      this->evict(shard, budget / SHARD_COUNT);
+    }
+  }
+
+  TileCache::Statistics TileCache::statistics() const
+  {
+    Statistics ret = { m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed),
+                       m_evictions.load(std::memory_order_relaxed), 0, 0, 0 };
+    for(const Shard& shard in m_shards)
+    {
+      QMutexLocker lock(&shard.mutex);
+      ret.bytes += shard.bytes;
+      ret.entries += shard.index.size();
+      ret.missing += shard.missing;
+    }
+    return ret;
+  }
+
+  qint64 TileCache::costOf(const QByteArray& data) noexcept { return data.isEmpty() ? MISSING_ENTRY_BYTES : data.size(); }
+
+  TileCache::Shard& TileCache::shardFor(TileKey key) noexcept
+  {
+    return m_shards[(key * 0x9E37'79B9'7F4A'7C15ull) >> (64 - SHARD_BITS)];
+  }
+
+  const TileCache::Shard& TileCache::shardFor(TileKey key) const noexcept
+  {
+    return m_shards[(key * 0x9E37'79B9'7F4A'7C15ull) >> (64 - SHARD_BITS)];
+  }
+
+  void TileCache::evict(Shard& shard, qint64 budget)
+  {
+    while(shard.bytes > budget and not shard.lru.empty())
+    {
+      shard.bytes -= costOf(shard.lru.back().second);
+      shard.missing -= shard.lru.back().second.isEmpty() ? 1 : 0;
+      shard.index.remove(shard.lru.back().first);
+      shard.lru.pop_back();
+      m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+} // CCL
@@ -0,0 +1,84 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include "tilestorage.h"
+
+using std::list;
+
+namespace CCL
+{
+  /**
+   * Thread-safe LRU cache of tile payloads with a byte budget.
+   * Keys are spread over independently locked shards, each shard owns an equal
+   * slice of the budget. Returned QByteArrays share data with the cache entry.
+   * Inserting empty data records the tile as missing: find() then returns an empty,
+   * non-null array instead of a null one, so absent tiles are not re-read on every call.
+   */
+  class TileCache
+  {
+    constexpr static const int SHARD_BITS = 4;
+    constexpr static const int SHARD_COUNT = 1 << SHARD_BITS;
+    constexpr static const qint64 MISSING_ENTRY_BYTES = 64;
+
+    public:
+      struct Statistics
+      {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        qint64 bytes;
+        int entries;
+        int missing;
+      };
+
+      explicit TileCache(qint64 budget = 64 * 1024 * 1024);
+
+      [[nodiscard]] QByteArray find(TileKey key);
+      [[nodiscard]] bool contains(TileKey key) const;
+      void insert(TileKey key, const QByteArray& data);
+      void remove(TileKey key);
+      void clear();
+
+      [[nodiscard]] qint64 budget() const noexcept;
+      void setBudget(qint64 budget);
+      [[nodiscard]] Statistics statistics() const;
+
+    private:
+      struct Shard
+      {
+        using Entry = std::pair<TileKey, QByteArray>;
+
+        mutable QMutex mutex;
+        list<Entry> lru;
+        QHash<TileKey, list<Entry>::iterator> index;
+        qint64 bytes = 0;
+        int missing = 0;
+      };
+
+      /// Budget charge of an entry, missing tiles still cost their bookkeeping.
+      [[nodiscard]] static qint64 costOf(const QByteArray& data) noexcept;
+
+      Shard& shardFor(TileKey key) noexcept;
+      [[nodiscard]] const Shard& shardFor(TileKey key) const noexcept;
+      void evict(Shard& shard, qint64 budget);
+
+    private:
+      std::array<Shard, SHARD_COUNT> m_shards;
+      std::atomic<qint64> m_budget;
+      std::atomic<uint64_t> m_hits;
+      std::atomic<uint64_t> m_misses;
+      std::atomic<uint64_t> m_evictions;
+  };
+} // CCL
@@ -0,0 +1,233 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "tilecoverage.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <QtPositioning/QGeoPolygon>
+
+#define in :
+
+constexpr const double MAX_MERCATOR_LATITUDE = 85.051'128'779'806'59;
+
+namespace
+{
+  struct Edge
+  {
+    double x0, y0;
+    double x1, y1;
+    double y_min, y_max;
+
+    [[nodiscard]] double xAt(double y) const noexcept
+    {
+      return x0 + (y - y0) * (x1 - x0) / (y1 - y0);
+    }
+  };
+
+  uint32_t clampTile(double value, double limit) noexcept
+  {
+    return static_cast<uint32_t>(std::clamp(value, 0.0, limit - 1));
+  }
+} // namespace
+
+namespace CCL
+{
+  TileCoverage::TileCoverage(const QGeoPolygon& polygon)
+  {
+    auto project = [](const QList<QGeoCoordinate>& path) {
+      vector<Vertex> ring;
+      ring.reserve(path.size());
+      for(const QGeoCoordinate& point in path)
+      {
+        double latitude = std::clamp(point.latitude(), -MAX_MERCATOR_LATITUDE, MAX_MERCATOR_LATITUDE);
+        double u = std::clamp((point.longitude() + 180.0) / 360.0, 0.0, 1.0);
+        double v = (1.0 - std::asinh(std::tan(latitude * M_PI / 180.0)) / M_PI) / 2.0;
+        ring.push_back({ u, v });
+      }
+      return ring;
+    };
+
+    auto rings = std::make_shared<Rings>();
+    if(polygon.size() >= 3)
+    {
+      rings->push_back(project(polygon.path()));
+      for(int i = 0; i < polygon.holesCount(); i++)
+        if(polygon.holePath(i).size() >= 3)
+          rings->push_back(project(polygon.holePath(i)));
+    }
+    m_rings = std::move(rings);
+  }
+
+  bool TileCoverage::isEmpty() const noexcept { return m_rings->empty(); }
+
+  /**
+   * Calls f(y, x_first, x_last) for every merged span of zoom level, rows in ascending order.
+   * A tile is covered when a polygon edge crosses it (edges clipped to the row strip) or
+   * when its row centerline lies inside the polygon (even-odd crossings at y + 0.5).
+   */
+  template<typename F>
+  void TileCoverage::rasterize(const Rings& rings, int zoom, F&& f)
+  {
+    if(zoom < 0 or zoom > 30)
+      throw std::invalid_argument("CCL.TileCoverage.rasterize: zoom must be in range [0 - 30]");
+
+    const double n = std::ldexp(1.0, zoom);
+    vector<Edge> edges;
+    for(const auto& ring in rings)
+    {
+      for(size_t i = 0; i < ring.size(); i++)
+      {
+        const Vertex& a = ring[i];
+        const Vertex& b = ring[(i + 1) % ring.size()];
+        Edge edge = { a.u * n, a.v * n, b.u * n, b.v * n, 0, 0 };
+        edge.y_min = std::min(edge.y0, edge.y1);
+        edge.y_max = std::max(edge.y0, edge.y1);
+        edges.push_back(edge);
+      }
+    }
+    if(edges.empty())
+      return;
+
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.y_min < b.y_min; });
+    double y_max = std::max_element(edges.cbegin(), edges.cend(), [](const Edge& a, const Edge& b) {
+      return a.y_max < b.y_max;
+    })->y_max;
+
+    uint32_t row_first = clampTile(std::floor(edges.front().y_min), n);
+    uint32_t row_last = std::max(row_first, clampTile(std::ceil(y_max) - 1, n));
+
+    vector<const Edge*> active;
+    vector<double> crossings;
+    vector<std::pair<uint32_t, uint32_t>> row_spans;
+    size_t next = 0;
+    for(uint32_t row = row_first; row <= row_last; row++)
+    {
+      const double top = row;
+      const double bottom = row + 1.0;
+      const double center = row + 0.5;
+
+      while(next < edges.size() and edges[next].y_min < bottom)
+        active.push_back(&edges[next++]);
+      active.erase(std::remove_if(active.begin(), active.end(), [top](const Edge* e) { return e->y_max <= top; }),
+                   active.end());
+
+      row_spans.clear();
+      crossings.clear();
+      for(const Edge* edge in active)
+      {
+        double x_a = edge->x0;
+        double x_b = edge->x1;
+        if(edge->y0 != edge->y1)
+        {
+          x_a = edge->xAt(std::max(edge->y_min, top));
+          x_b = edge->xAt(std::min(edge->y_max, bottom));
+        }
+
+        uint32_t first = clampTile(std::floor(std::min(x_a, x_b)), n);
+        uint32_t last = std::max(first, clampTile(std::ceil(std::max(x_a, x_b)) - 1, n));
+        row_spans.emplace_back(first, last);
+
+        if(edge->y_min <= center and center < edge->y_max)
+          crossings.push_back(edge->xAt(center));
+      }
+
+      std::sort(crossings.begin(), crossings.end());
+      for(size_t i = 0; i + 1 < crossings.size(); i += 2)
+        row_spans.emplace_back(clampTile(std::floor(crossings[i]), n), clampTile(std::floor(crossings[i + 1]), n));
+
+      if(row_spans.empty())
+        continue;
+
+      std::sort(row_spans.begin(), row_spans.end());
+      auto current = row_spans.front();
+      for(const auto& span in row_spans)
+      {
+        if(span.first <= current.second + 1)
+          current.second = std::max(current.second, span.second);
+        else
+        {
+          f(row, current.first, current.second);
+          current = span;
+        }
+      }
+      f(row, current.first, current.second);
+    }
+  }
+
+  vector<TileSpan> TileCoverage::spans(int zoom) const
+  {
+    vector<TileSpan> ret;
+    rasterize(*m_rings, zoom, [&ret, zoom](uint32_t y, uint32_t first, uint32_t last) {
+      ret.push_back({ zoom, y, first, last });
+    });
+    return ret;
+  }
+
+  uint64_t TileCoverage::count(int zoom) const
+  {
+    uint64_t ret = 0;
+    rasterize(*m_rings, zoom, [&ret](uint32_t, uint32_t first, uint32_t last) { ret += last - first + 1; });
+    return ret;
+  }
+
+  uint64_t TileCoverage::count(int min_zoom, int max_zoom) const
+  {
+    uint64_t ret = 0;
+    for(int zoom = min_zoom; zoom <= max_zoom; zoom++)
+      ret += count(zoom);
+    return ret;
+  }
+
+  TileCoverage::Cursor TileCoverage::cursor(int min_zoom, int max_zoom) const { return { m_rings, min_zoom, max_zoom }; }
+
+  TileCoverage::Cursor::Cursor(std::shared_ptr<const Rings> rings, int min_zoom, int max_zoom)
+    : m_rings(std::move(rings))
+    , m_span(0)
+    , m_x(0)
+    , m_zoom(min_zoom)
+    , m_max_zoom(max_zoom)
+  {
+    this->advance();
+  }
+
+  bool TileCoverage::Cursor::next(int& zoom, int& x, int& y)
+  {
+    if(atEnd())
+      return false;
+
+    const TileSpan& span = m_spans[m_span];
+    zoom = span.zoom;
+    x = static_cast<int>(m_x);
+    y = static_cast<int>(span.y);
+
+    if(m_x < span.x_last)
+      m_x++;
+    else if(++m_span < m_spans.size())
+      m_x = m_spans[m_span].x_first;
+    else
+      this->advance();
+    return true;
+  }
+
+  bool TileCoverage::Cursor::atEnd() const noexcept { return m_span >= m_spans.size(); }
+
+  void TileCoverage::Cursor::advance()
+  {
+    m_spans.clear();
+    m_span = 0;
+    while(m_spans.empty() and m_zoom <= m_max_zoom)
+    {
+      int zoom = m_zoom++;
+      rasterize(*m_rings, zoom, [this, zoom](uint32_t y, uint32_t first, uint32_t last) {
+        m_spans.push_back({ zoom, y, first, last });
+      });
+    }
+    if(not m_spans.empty())
+      m_x = m_spans.front().x_first;
+  }
+} // CCL
@@ -0,0 +1,84 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using std::vector;
+
+class QGeoPolygon;
+
+namespace CCL
+{
+  /// Run of horizontally adjacent tiles [x_first, x_last] in row y.
+  struct TileSpan
+  {
+    int zoom;
+    uint32_t y;
+    uint32_t x_first;
+    uint32_t x_last;
+  };
+
+  /**
+   * Set of slippy map tiles intersected by a polygon (holes included).
+   * Tiles are found by scanline rasterization of the polygon in tile space,
+   * so cost follows the number of covered rows and spans rather than the
+   * bounding box area. The class is immutable and reentrant: it can be
+   * built and queried from a worker thread.
+   */
+  class TileCoverage
+  {
+    struct Vertex
+    {
+      double u;
+      double v;
+    };
+
+    using Rings = vector<vector<Vertex>>;
+
+    public:
+      explicit TileCoverage(const QGeoPolygon& polygon);
+
+      [[nodiscard]] bool isEmpty() const noexcept;
+      [[nodiscard]] vector<TileSpan> spans(int zoom) const;
+      [[nodiscard]] uint64_t count(int zoom) const;
+      [[nodiscard]] uint64_t count(int min_zoom, int max_zoom) const;
+
+      /// Lazy tile generator, walks zoom levels in ascending order.
+      class Cursor
+      {
+        public:
+          bool next(int& zoom, int& x, int& y);
+          [[nodiscard]] bool atEnd() const noexcept;
+
+        private:
+          friend class TileCoverage;
+          Cursor(std::shared_ptr<const Rings> rings, int min_zoom, int max_zoom);
+          void advance();
+
+        private:
+          std::shared_ptr<const Rings> m_rings;
+          vector<TileSpan> m_spans;
+          size_t m_span;
+          uint32_t m_x;
+          int m_zoom;
+          int m_max_zoom;
+      };
+
+      [[nodiscard]] Cursor cursor(int min_zoom, int max_zoom) const;
+
+    private:
+      template<typename F>
+      static void rasterize(const Rings& rings, int zoom, F&& f);
+
+    private:
+      std::shared_ptr<const Rings> m_rings;
+  };
+} // CCL
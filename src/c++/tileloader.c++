@@ -6,204 +6,373 @@
  * ---------------------------------------------------------------------- */
 
 #include "tileloader.h"
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 #include <QtCore/QCoreApplication>
-#include <QtCore/QDir>
-#include <QtGui/QPolygonF>
+#include <QtCore/QTimer>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtNetwork/QNetworkReply>
 #include <QtPositioning/QGeoPolygon>
-#include <QtPositioning/QGeoRectangle>
+#include "metrics.h"
 #define in :
 
 namespace CCL
 {
-  TileLoader::Tile::Tile(int zoom, int x, int y)
-    : zoom(zoom)
-    , x(x)
-    , y(y)
-  {}
-
   TileLoader::TileLoader(QString storageUrl, QObject* parent)
     : QObject(parent)
     , m_nam(new QNetworkAccessManager(this))
-    , m_total_tiles(0)
-    , m_loaded_tiles(0)
-    , m_parallel_loaded_count(0)
+    , m_window_start(0)
+    , m_window_bytes(0)
+    , m_window_tiles(0)
+    , m_tiles_per_second(0)
+    , m_bytes_per_second(0)
     , m_server_url("https://mt.google.com/vt/lyrs=y&hl=ru&z=%1&x=%2&y=%3")
     , m_storage_url(std::move(storageUrl))
+    , m_storage_backend(Directory)
+    , m_storage_epoch(0)
+    , m_statistics_timer(new QTimer(this))
+    , m_prefetch(false)
+    , m_prefetch_epoch(0)
+    , m_transfer_timeout(DEFAULT_TRANSFER_TIMEOUT)
+    , m_dispatch_scheduled(false)
   {
     connect(m_nam, &QNetworkAccessManager::finished, this, &TileLoader::onFinished);
+    connect(&m_prefetch_watcher, &QFutureWatcher<Prefetched>::finished, this, &TileLoader::onPrefetched);
+
+    // tileAt runs per painted tile, statistics are coalesced into one notification per interval.
+    m_statistics_timer->setSingleShot(true);
+    m_statistics_timer->setInterval(STATISTICS_INTERVAL);
+    connect(m_statistics_timer, &QTimer::timeout, this, &TileLoader::cacheStatisticsChanged);
+    m_scheduler.setSkipPredicate([this](TileKey key) {
+      return m_storage->contains(tileKeyZoom(key), tileKeyX(key), tileKeyY(key));
+    });
+    m_clock.start();
+    this->resetStorage();
   }
 
-  void TileLoader::download(int zoom, int x, int y)
+  int TileLoader::download(int zoom, int x, int y)
   {
-    m_queue.emplace(zoom, x, y);
-    m_total_tiles++;
-
-    if(m_parallel_loaded_count < MAX_ALLOWED_PARALLEL)
-      this->process();
+    int job = m_scheduler.addJob(packTileKey(zoom, x, y));
+    this->dispatch();
+    this->settle();
+    return job;
   }
 
-  void TileLoader::download(const QGeoPolygon& polygon, int zoom)
+  int TileLoader::download(const QGeoPolygon& polygon, int zoom)
   {
     if(zoom > 20 or zoom < 0)
       throw std::invalid_argument("CCL.TileLoader.download: Maximum zoom must be in range [0 - 20]");
 
-    QGeoRectangle rectangle = polygon.boundingGeoRectangle();
-    double minLatitude = rectangle.bottomLeft().latitude();
-    double maxLatitude = rectangle.topRight().latitude();
-    double minLongitude = rectangle.bottomLeft().longitude();
-    double maxLongitude = rectangle.topRight().longitude();
+    int job = m_scheduler.addJob(TileCoverage(polygon), 0, zoom);
+    this->dispatch();
+    this->settle();
+    return job;
+  }
 
-    if(minLongitude > maxLongitude)
-    {
-      minLongitude = rectangle.topRight().longitude();
-      maxLongitude = rectangle.bottomLeft().longitude();
-    }
+  int TileLoader::download(const QList<QVariant>& list, int zoom)
+  {
+    QGeoPolygon pass;
+    for(const auto& point in list)
+      pass.addCoordinate(point.value<QGeoCoordinate>());
+    return this->download(pass, zoom);
+  }
 
-    QPolygonF polygon2;
-    for(int index = 0; index < polygon.size(); index++)
-    {
-      QGeoCoordinate point = polygon.coordinateAt(index);
-      polygon2.append(QPointF(point.longitude(), point.latitude()));
-    }
+  void TileLoader::cancel(int job)
+  {
+    m_scheduler.cancel(job);
 
-    for(int z = 0; z <= zoom; z++)
+    // Requests another job still waits on keep running for it.
+    QList<QNetworkReply*> replies;
+    for(auto it = m_in_flight.begin(); it != m_in_flight.end(); it++)
     {
-      uint32_t minX = longitudeToTileX(minLongitude, z);
-      uint32_t maxX = longitudeToTileX(maxLongitude, z);
-      uint32_t minY = latitudeToTileY(maxLatitude, z);
-      uint32_t maxY = latitudeToTileY(minLatitude, z);
-
-      for(uint32_t x = minX; x <= maxX; x++)
-      {
-        for(uint32_t y = minY; y <= maxY; y++)
-        {
-          double x0 = tileXToLongitude(x, z);
-          double y0 = tileYToLatitude(y, z);
-          double x1 = tileXToLongitude(x + 1, z);
-          double y1 = tileYToLatitude(y + 1, z);
-
-          if(polygon2.intersects(QPolygonF(QRectF(QPointF(x0, y0), QPointF(x1, y1)))))
-            this->download(z, (int)x, (int)y);
-        }
-      }
+      if(m_scheduler.isWanted(it->request.key))
+        continue;
+      it->cancelled = true;
+      replies.push_back(it.key());
     }
+    for(QNetworkReply* reply in replies)
+      reply->abort();
+
+    this->settle();
   }
 
-  void TileLoader::download(const QList<QVariant>& list, int zoom)
+  void TileLoader::cancelAll()
   {
-    QGeoPolygon pass;
-    for(const auto& point in list)
-      pass.addCoordinate(point.value<QGeoCoordinate>());
-    this->download(pass, zoom);
+    for(int job in m_scheduler.jobs())
+      this->cancel(job);
   }
 
+  void TileLoader::setFocus(double latitude, double longitude) { m_scheduler.setFocus(latitude, longitude); }
+
   int TileLoader::estimate(const QList<QVariant>& list, int zoom_max)
   {
     QGeoPolygon polygon;
     for(const auto& point in list)
       polygon.addCoordinate(point.value<QGeoCoordinate>());
 
-    int ret = 0;
-    QGeoRectangle rectangle = polygon.boundingGeoRectangle();
-    double minLatitude = rectangle.bottomLeft().latitude();
-    double maxLatitude = rectangle.topRight().latitude();
-    double minLongitude = rectangle.bottomLeft().longitude();
-    double maxLongitude = rectangle.topRight().longitude();
+    uint64_t ret = TileCoverage(polygon).count(0, zoom_max);
+    return static_cast<int>(std::min<uint64_t>(ret, std::numeric_limits<int>::max()));
+  }
 
-    if(minLongitude > maxLongitude)
+  QByteArray TileLoader::tileAt(int zoom, int x, int y)
+  {
+    TileKey key = packTileKey(zoom, x, y);
+    QByteArray ret = m_cache.find(key);
+    if(ret.isNull())
     {
-      minLongitude = rectangle.topRight().longitude();
-      maxLongitude = rectangle.bottomLeft().longitude();
+      CCL_METRIC_ADD(TileCacheMisses, 1);
+      ret = m_storage->read(zoom, x, y);
+      m_cache.insert(key, ret);
+      if(m_prefetch)
+        this->prefetchAround(key);
     }
+    else
+      CCL_METRIC_ADD(TileCacheHits, 1);
 
-    QPolygonF polygon2;
-    for(int index = 0; index < polygon.size(); index++)
-    {
-      QGeoCoordinate point = polygon.coordinateAt(index);
-      polygon2.append(QPointF(point.longitude(), point.latitude()));
-    }
+    if(not m_statistics_timer->isActive())
+      m_statistics_timer->start();
+    return ret;
+  }
 
-    for(int zoom = 0; zoom <= zoom_max; zoom++)
-    {
-      uint32_t minX = longitudeToTileX(minLongitude, zoom);
-      uint32_t maxX = longitudeToTileX(maxLongitude, zoom);
-      uint32_t minY = latitudeToTileY(maxLatitude, zoom);
-      uint32_t maxY = latitudeToTileY(minLatitude, zoom);
+  void TileLoader::setStorage(std::unique_ptr<TileStorage> storage)
+  {
+    if(storage == nullptr)
+      throw std::invalid_argument("CCL.TileLoader.setStorage: storage must not be null");
+    m_cache.clear();
+    this->retireStorage();
+    m_storage = std::move(storage);
+    m_storage_epoch++;
+  }
 
-      for(uint32_t x = minX; x <= maxX; x++)
+  void TileLoader::onFinished(QNetworkReply* reply)
+  {
+    reply->deleteLater();
+    auto it = m_in_flight.find(reply);
+    if(it == m_in_flight.end())
+      return;
+
+    InFlight in_flight = it.value();
+    m_in_flight.erase(it);
+
+    qint64 bytes = 0;
+    TileScheduler::Result result = TileScheduler::Result::RetryableFailure;
+    switch(reply->error())
+    {
+      case QNetworkReply::NoError:
       {
-        for(uint32_t y = minY; y <= maxY; y++)
+        TileKey key = in_flight.request.key;
+        QByteArray data = reply->readAll();
+        bytes = data.size();
         {
-          double x0 = tileXToLongitude(x, zoom);
-          double y0 = tileYToLatitude(y, zoom);
-          double x1 = tileXToLongitude(x + 1, zoom);
-          double y1 = tileYToLatitude(y + 1, zoom);
-
-          if(polygon2.intersects(QPolygonF(QRectF(QPointF(x0, y0), QPointF(x1, y1)))))
-            ret++;
+          CCL_METRIC_SCOPE(DiskWrite);
+          m_storage->write(tileKeyZoom(key), tileKeyX(key), tileKeyY(key), data);
         }
+        m_cache.remove(key);
+        m_storage_epoch++;
+        result = TileScheduler::Result::Success;
+        break;
       }
+      // Also raised by the transfer timeout, that one is worth another attempt.
+      case QNetworkReply::OperationCanceledError:
+        if(in_flight.cancelled)
+          result = TileScheduler::Result::Cancelled;
+        break;
+      case QNetworkReply::ContentAccessDenied:
+      case QNetworkReply::ContentNotFoundError:
+      case QNetworkReply::ContentGoneError:
+      case QNetworkReply::AuthenticationRequiredError:
+      case QNetworkReply::ProtocolInvalidOperationError:
+        result = TileScheduler::Result::PermanentFailure;
+        break;
+      default:
+        break;
     }
 
-    return ret;
+    TileScheduler::Request request = in_flight.request;
+    qint64 latency = m_clock.elapsed() - in_flight.started;
+    CCL_METRIC_RECORD(TileLatency, static_cast<uint64_t>(latency) * 1'000);
+    CCL_METRIC_ADD(TileBytes, static_cast<uint64_t>(bytes));
+
+    // A failure nobody waits for anymore is not reported, its jobs were cancelled.
+    const bool wanted = m_scheduler.isWanted(request.key);
+    int delay = m_scheduler.complete(request, result, latency);
+    if(result == TileScheduler::Result::Cancelled)
+      CCL_METRIC_ADD(TileCancellations, 1);
+    else if(delay >= 0)
+      CCL_METRIC_ADD(TileRetries, 1);
+    else if(result != TileScheduler::Result::Success and wanted)
+      CCL_METRIC_ADD(TileFailures, 1);
+    if(delay >= 0)
+      QTimer::singleShot(delay, this, [this, request]() {
+        m_scheduler.requeue(request);
+        this->dispatch();
+        this->settle();
+      });
+
+    this->updateRates(bytes);
+    this->dispatch();
+    this->settle();
   }
 
-  QByteArray TileLoader::tileAt(int zoom, int x, int y)
+  /// Runs after anything that may leave the scheduler idle: completions, requeues of cancelled retries, cancels.
+  void TileLoader::settle()
   {
-    QByteArray ret;
-    QFile tileFile(storageUrl() + QString("/%1/%2/%3").arg(zoom).arg(x).arg(y));
-    if(tileFile.exists())
+    if(m_scheduler.isIdle())
     {
-      tileFile.open(QIODevice::ReadOnly);
-      ret = tileFile.readAll();
-      tileFile.close();
+      m_storage->flush();
+      m_scheduler.resetCounters();
+      m_tiles_per_second = 0;
+      m_bytes_per_second = 0;
     }
 
-    return ret;
+    emit progressChanged();
   }
 
-  void TileLoader::onFinished(QNetworkReply* reply)
+  void TileLoader::dispatch()
   {
-    if(reply->error() == QNetworkReply::NoError)
+    while(auto request = m_scheduler.take())
     {
-      QDir tilePath(storageUrl() + reply->property("filePath").toString());
-      if(not tilePath.exists())
-        tilePath.mkpath(".");
-
-      QFile tileFile(tilePath.filePath(reply->property("fileName").toString()));
-      tileFile.open(QIODevice::WriteOnly);
-      tileFile.write(reply->readAll());
-      tileFile.close();
+      TileKey key = request->key;
+      QNetworkRequest get(serverUrl().arg(tileKeyZoom(key)).arg(tileKeyX(key)).arg(tileKeyY(key)));
+      #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+      get.setTransferTimeout(m_transfer_timeout);
+      QNetworkReply* reply = m_nam->get(get);
+      #else
+      // Restarted by every chunk received, an inactivity timeout like setTransferTimeout.
+      QNetworkReply* reply = m_nam->get(get);
+      auto* timeout = new QTimer(reply);
+      timeout->setSingleShot(true);
+      timeout->setInterval(m_transfer_timeout);
+      connect(timeout, &QTimer::timeout, reply, &QNetworkReply::abort);
+      connect(reply, &QNetworkReply::downloadProgress, timeout, qOverload<>(&QTimer::start));
+      timeout->start();
+      #endif
+      m_in_flight.insert(reply, { *request, m_clock.elapsed(), false });
+      CCL_METRIC_ADD(TileRequests, 1);
     }
 
-    reply->deleteLater();
-    m_parallel_loaded_count--;
-    m_loaded_tiles++;
+    // Skip checks of an area already on disk are budgeted per take(), the rest runs on the next turns.
+    if(m_scheduler.refillPending() and not m_dispatch_scheduled)
+    {
+      m_dispatch_scheduled = true;
+      QTimer::singleShot(0, this, [this]() {
+        m_dispatch_scheduled = false;
+        this->dispatch();
+        this->settle();
+      });
+    }
 
-    emit progressChanged();
+    CCL_METRIC_SET(TileQueueDepth, static_cast<int64_t>(m_scheduler.queued()));
+    CCL_METRIC_SET(TilesInFlight, m_scheduler.inFlight());
+  }
+
+  void TileLoader::updateRates(qint64 bytes)
+  {
+    m_window_bytes += bytes;
+    m_window_tiles += bytes > 0 ? 1 : 0;
+
+    qint64 now = m_clock.elapsed();
+    qint64 elapsed = now - m_window_start;
+    if(elapsed < RATE_WINDOW)
+      return;
 
-    if(not m_queue.empty())
-      this->process();
+    m_tiles_per_second = static_cast<double>(m_window_tiles) * 1000.0 / static_cast<double>(elapsed);
+    m_bytes_per_second = static_cast<double>(m_window_bytes) * 1000.0 / static_cast<double>(elapsed);
+    m_window_start = now;
+    m_window_bytes = 0;
+    m_window_tiles = 0;
+  }
 
-    if(m_total_tiles == m_loaded_tiles)
+  void TileLoader::resetStorage()
+  {
+    m_cache.clear();
+    this->retireStorage();
+    if(m_storage_backend == Packed)
+      m_storage = std::make_shared<PackedTileStorage>(storageUrl() + "/" + PACKED_STORAGE_FILE);
+    else
+      m_storage = std::make_shared<DirectoryTileStorage>(storageUrl());
+    m_storage_epoch++;
+  }
+
+  /**
+   * Storage reads may be views into the storage's own memory (PackedTileStorage mappings) and
+   * tileAt hands them out without copying. A replaced storage is flushed and kept until the
+   * loader is destroyed, so those views never dangle; swaps only follow url or backend changes.
+   */
+  void TileLoader::retireStorage()
+  {
+    if(m_storage == nullptr)
+      return;
+    m_storage->flush();
+    m_retired_storages.push_back(std::move(m_storage));
+  }
+
+  /**
+   * Warms the cache with the 8 neighbours, the parent and the 4 children of a tile.
+   * Storage reads run on the global thread pool, one batch at a time: a miss arriving
+   * while a batch is running replaces the pending center, so fast panning only
+   * prefetches around the latest tile.
+   */
+  void TileLoader::prefetchAround(TileKey key)
+  {
+    if(m_prefetch_watcher.isRunning())
     {
-      m_total_tiles = 0;
-      m_loaded_tiles = 0;
+      m_prefetch_next = key;
+      return;
     }
+
+    const int zoom = tileKeyZoom(key), x = tileKeyX(key), y = tileKeyY(key);
+    std::vector<TileKey> wanted;
+    auto want = [this, &wanted](int z, int tx, int ty) {
+      if(z < 0 or z > 20 or tx < 0 or ty < 0 or tx >= (1 << z) or ty >= (1 << z))
+        return;
+      TileKey neighbour = packTileKey(z, tx, ty);
+      if(not m_cache.contains(neighbour))
+        wanted.push_back(neighbour);
+    };
+
+    for(int dx = -1; dx <= 1; dx++)
+      for(int dy = -1; dy <= 1; dy++)
+        if(dx != 0 or dy != 0)
+          want(zoom, x + dx, y + dy);
+
+    want(zoom - 1, x / 2, y / 2);
+    for(int i = 0; i < 4; i++)
+      want(zoom + 1, 2 * x + i % 2, 2 * y + i / 2);
+    if(wanted.empty())
+      return;
+
+    // The task owns a reference to the storage, a backend swap meanwhile cannot free it under the reads.
+    std::shared_ptr<TileStorage> storage = m_storage;
+    m_prefetch_epoch = m_storage_epoch;
+    m_prefetch_watcher.setFuture(QtConcurrent::run([storage, wanted]() {
+      Prefetched ret;
+      ret.reserve(wanted.size());
+      for(TileKey neighbour in wanted)
+        ret.emplace_back(neighbour, storage->read(tileKeyZoom(neighbour), tileKeyX(neighbour), tileKeyY(neighbour)));
+      return ret;
+    }));
   }
 
-  void TileLoader::process()
+  void TileLoader::onPrefetched()
   {
-    Tile tileItem = m_queue.front();
-    m_queue.pop();
-    QNetworkReply* reply = m_nam->get(QNetworkRequest(serverUrl().arg(tileItem.zoom).arg(tileItem.x).arg(tileItem.y)));
-    reply->setProperty("filePath", QString("/%1/%2").arg(tileItem.zoom).arg(tileItem.x));
-    reply->setProperty("fileName", QString("%1").arg(tileItem.y));
+    const Prefetched result = m_prefetch_watcher.result();
+
+    // Any write or storage swap since the reads started may have made them stale,
+    // drop them rather than cache outdated or missing tiles.
+    if(m_prefetch_epoch == m_storage_epoch)
+      for(const auto& [key, data] in result)
+        if(not m_cache.contains(key))
+          m_cache.insert(key, data);
 
-    m_parallel_loaded_count++;
+    if(m_prefetch_next)
+    {
+      TileKey next = *m_prefetch_next;
+      m_prefetch_next.reset();
+      this->prefetchAround(next);
+    }
   }
 
   uint32_t TileLoader::longitudeToTileX(double longitude, uint8_t zoom) { return static_cast<uint32_t>((longitude + 180.0) / 360.0 * (1 << zoom)); }
@@ -231,8 +400,78 @@ namespace CCL
     if(x == m_storage_url)
       return;
     m_storage_url = x;
+    this->resetStorage();
     emit storageUrlChanged();
   }
 
-  int TileLoader::progress() const { return (m_loaded_tiles * 100 / m_total_tiles); }
+  TileLoader::StorageBackend TileLoader::storageBackend() const { return m_storage_backend; }
+  void TileLoader::setStorageBackend(StorageBackend x) {
+    if(x == m_storage_backend)
+      return;
+    m_storage_backend = x;
+    this->resetStorage();
+    emit storageBackendChanged();
+  }
+
+  qint64 TileLoader::cacheBudget() const { return m_cache.budget(); }
+  void TileLoader::setCacheBudget(qint64 x) {
+    if(x == m_cache.budget())
+      return;
+    m_cache.setBudget(x);
+    emit cacheBudgetChanged();
+    emit cacheStatisticsChanged();
+  }
+
+  bool TileLoader::prefetch() const { return m_prefetch; }
+  void TileLoader::setPrefetch(bool x) {
+    if(x == m_prefetch)
+      return;
+    m_prefetch = x;
+    emit prefetchChanged();
+  }
+
+  QVariantMap TileLoader::cacheStatistics() const
+  {
+    TileCache::Statistics stats = m_cache.statistics();
+    return { { "hits", static_cast<qulonglong>(stats.hits) },
+             { "misses", static_cast<qulonglong>(stats.misses) },
+             { "evictions", static_cast<qulonglong>(stats.evictions) },
+             { "bytes", stats.bytes },
+             { "entries", stats.entries },
+             { "missing", stats.missing } };
+  }
+
+  int TileLoader::progress() const
+  {
+    if(m_scheduler.total() == 0)
+      return 0;
+    return static_cast<int>(m_scheduler.finished() * 100 / m_scheduler.total());
+  }
+
+  int TileLoader::failedTiles() const { return static_cast<int>(m_scheduler.failed()); }
+  double TileLoader::tilesPerSecond() const { return m_tiles_per_second; }
+  double TileLoader::bytesPerSecond() const { return m_bytes_per_second; }
+  int TileLoader::parallel() const { return m_scheduler.concurrency(); }
+
+  int TileLoader::transferTimeout() const { return m_transfer_timeout; }
+  void TileLoader::setTransferTimeout(int x) {
+    if(x <= 0)
+      throw std::invalid_argument("CCL.TileLoader.setTransferTimeout: timeout must be positive");
+    if(x == m_transfer_timeout)
+      return;
+    m_transfer_timeout = x;
+    emit transferTimeoutChanged();
+  }
+
+  int TileLoader::maxParallel() const { return m_scheduler.limits().max_parallel; }
+  void TileLoader::setMaxParallel(int x) {
+    if(x == maxParallel())
+      return;
+    TileScheduler::Limits limits = m_scheduler.limits();
+    limits.max_parallel = x;
+    limits.min_parallel = std::min(limits.min_parallel, x);
+    m_scheduler.setLimits(limits);
+    this->dispatch();
+    emit maxParallelChanged();
+  }
 } // CCL
\ No newline at end of file
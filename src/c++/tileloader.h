@@ -7,16 +7,25 @@
 
 #pragma once
 
-#include <queue>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QHash>
 #include <QtCore/QObject>
+#include <QtCore/QVariantMap>
+#include "tilecache.h"
+#include "tilescheduler.h"
+#include "tilestorage.h"
 #define invokable Q_INVOKABLE
 #define slot Q_SLOT
 
-using std::queue;
-
 class QGeoPolygon;
 class QNetworkAccessManager;
 class QNetworkReply;
+class QTimer;
 
 namespace CCL
 {
@@ -25,54 +34,116 @@ namespace CCL
     Q_OBJECT
     Q_PROPERTY(QString serverUrl READ serverUrl WRITE setServerUrl NOTIFY serverUrlChanged FINAL)
     Q_PROPERTY(QString storageUrl READ storageUrl WRITE setStorageUrl NOTIFY storageUrlChanged FINAL)
+    Q_PROPERTY(StorageBackend storageBackend READ storageBackend WRITE setStorageBackend NOTIFY storageBackendChanged FINAL)
     Q_PROPERTY(int progress READ progress NOTIFY progressChanged STORED false FINAL);
-
-    constexpr static const uint8_t MAX_ALLOWED_PARALLEL = 4;
+    Q_PROPERTY(int failedTiles READ failedTiles NOTIFY progressChanged STORED false FINAL)
+    Q_PROPERTY(double tilesPerSecond READ tilesPerSecond NOTIFY progressChanged STORED false FINAL)
+    Q_PROPERTY(double bytesPerSecond READ bytesPerSecond NOTIFY progressChanged STORED false FINAL)
+    Q_PROPERTY(int parallel READ parallel NOTIFY progressChanged STORED false FINAL)
+    Q_PROPERTY(int maxParallel READ maxParallel WRITE setMaxParallel NOTIFY maxParallelChanged FINAL)
+    Q_PROPERTY(int transferTimeout READ transferTimeout WRITE setTransferTimeout NOTIFY transferTimeoutChanged FINAL)
+    Q_PROPERTY(qint64 cacheBudget READ cacheBudget WRITE setCacheBudget NOTIFY cacheBudgetChanged FINAL)
+    Q_PROPERTY(bool prefetch READ prefetch WRITE setPrefetch NOTIFY prefetchChanged FINAL)
+    Q_PROPERTY(QVariantMap cacheStatistics READ cacheStatistics NOTIFY cacheStatisticsChanged STORED false FINAL)
+
+    constexpr static const qint64 RATE_WINDOW = 1'000;
+    constexpr static const int STATISTICS_INTERVAL = 250;
+    constexpr static const int DEFAULT_TRANSFER_TIMEOUT = 30'000;
+    constexpr static const char* PACKED_STORAGE_FILE = "tiles.pack";
 
     public:
+      enum StorageBackend
+      {
+        Directory,
+        Packed
+      };
+      Q_ENUM(StorageBackend)
+
       explicit TileLoader(QString storageUrl, QObject* parent = nullptr);
 
       [[nodiscard]] QString serverUrl() const;    void setServerUrl(const QString&);
       [[nodiscard]] QString storageUrl() const;   void setStorageUrl(const QString&);
+      [[nodiscard]] StorageBackend storageBackend() const;   void setStorageBackend(StorageBackend);
       [[nodiscard]] int progress() const;
-
-      void download(int zoom, int x, int y);
-      void download(const QGeoPolygon&, int zoom = 18);
-      invokable void download(const QList<QVariant>&, int zoom = 18);
+      [[nodiscard]] int failedTiles() const;
+      [[nodiscard]] double tilesPerSecond() const;
+      [[nodiscard]] double bytesPerSecond() const;
+      [[nodiscard]] int parallel() const;
+      [[nodiscard]] int maxParallel() const;      void setMaxParallel(int);
+      [[nodiscard]] int transferTimeout() const;  void setTransferTimeout(int);
+      [[nodiscard]] qint64 cacheBudget() const;   void setCacheBudget(qint64);
+      [[nodiscard]] bool prefetch() const;        void setPrefetch(bool);
+      [[nodiscard]] QVariantMap cacheStatistics() const;
+
+      int download(int zoom, int x, int y);
+      int download(const QGeoPolygon&, int zoom = 18);
+      invokable int download(const QList<QVariant>&, int zoom = 18);
+      invokable void cancel(int job);
+      invokable void cancelAll();
+      invokable void setFocus(double latitude, double longitude);
       QByteArray tileAt(int zoom, int x, int y);
+      void setStorage(std::unique_ptr<TileStorage> storage);
 
       [[nodiscard]] invokable static int estimate(const QList<QVariant>&, int zoom = 18);
 
+      [[nodiscard]] static uint32_t longitudeToTileX(double longitude, uint8_t zoom);
+      [[nodiscard]] static uint32_t latitudeToTileY(double latitude, uint8_t zoom);
+      [[nodiscard]] static double tileXToLongitude(uint32_t x, uint8_t zoom);
+      [[nodiscard]] static double tileYToLatitude(uint32_t y, uint8_t zoom);
+
     signals:
       void serverUrlChanged();
       void storageUrlChanged();
+      void storageBackendChanged();
       void progressChanged();
+      void cacheBudgetChanged();
+      void prefetchChanged();
+      void cacheStatisticsChanged();
+      void maxParallelChanged();
+      void transferTimeoutChanged();
 
     private:
       slot void onFinished(QNetworkReply* reply);
-      void process();
-
-      static uint32_t longitudeToTileX(double longitude, uint8_t zoom);
-      static uint32_t latitudeToTileY(double latitude, uint8_t zoom);
-      static double tileXToLongitude(uint32_t x, uint8_t zoom);
-      static double tileYToLatitude(uint32_t y, uint8_t zoom);
+      void dispatch();
+      void settle();
+      void updateRates(qint64 bytes);
+      void resetStorage();
+      void retireStorage();
+      void prefetchAround(TileKey key);
+      void onPrefetched();
 
     private:
-      struct Tile
+      struct InFlight
       {
-        Tile(int zoom, int x, int y);
-
-        int zoom;
-        int x;
-        int y;
+        TileScheduler::Request request;
+        qint64 started;
+        bool cancelled;     ///< aborted by cancel(), not by the transfer timeout
       };
 
+      using Prefetched = std::vector<std::pair<TileKey, QByteArray>>;
+
       QNetworkAccessManager* m_nam;
-      long m_total_tiles;
-      long m_loaded_tiles;
-      queue<Tile> m_queue;
-      int m_parallel_loaded_count;
+      TileScheduler m_scheduler;
+      QHash<QNetworkReply*, InFlight> m_in_flight;
+      QElapsedTimer m_clock;
+      qint64 m_window_start;
+      qint64 m_window_bytes;
+      uint64_t m_window_tiles;
+      double m_tiles_per_second;
+      double m_bytes_per_second;
       QString m_server_url;
       QString m_storage_url;
+      StorageBackend m_storage_backend;
+      std::shared_ptr<TileStorage> m_storage;
+      std::vector<std::shared_ptr<TileStorage>> m_retired_storages;   ///< replaced, alive for the views tileAt returned
+      uint64_t m_storage_epoch;
+      TileCache m_cache;
+      QTimer* m_statistics_timer;
+      bool m_prefetch;
+      QFutureWatcher<Prefetched> m_prefetch_watcher;
+      uint64_t m_prefetch_epoch;
+      std::optional<TileKey> m_prefetch_next;
+      int m_transfer_timeout;   ///< ms without any data before a request is aborted and retried
+      bool m_dispatch_scheduled;
   };
 } // CCL
\ No newline at end of file
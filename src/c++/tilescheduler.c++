@@ -0,0 +1,342 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "tilescheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#define in :
+
+namespace CCL
+{
+  // QNetworkAccessManager opens at most 6 HTTP/1.1 connections per host, more requests in flight
+  // would only wait inside it and skew the latency AIMD adapts to.
+  TileScheduler::TileScheduler()
+    : m_limits({ 2, 6, 4, 500, 30'000, 1'500 })
+    , m_next_job(1)
+    , m_sequence(0)
+    , m_skip_checks(0)
+    , m_refill_cut(false)
+    , m_concurrency(4)
+    , m_in_flight(0)
+    , m_waiting(0)
+    , m_streak(0)
+    , m_latency(0)
+    , m_total(0)
+    , m_completed(0)
+    , m_failed(0)
+    , m_skipped(0)
+  {}
+
+  const TileScheduler::Limits& TileScheduler::limits() const noexcept { return m_limits; }
+  void TileScheduler::setLimits(const Limits& limits)
+  {
+    if(limits.min_parallel < 1 or limits.max_parallel < limits.min_parallel or limits.max_attempts < 1)
+      throw std::invalid_argument("CCL.TileScheduler.setLimits: invalid parallelism or attempt limits");
+    m_limits = limits;
+    m_concurrency = std::clamp(m_concurrency, m_limits.min_parallel, m_limits.max_parallel);
+  }
+
+  void TileScheduler::setFocus(double latitude, double longitude)
+  {
+    double u = (longitude + 180.0) / 360.0;
+    double v = (1.0 - std::asinh(std::tan(latitude * M_PI / 180.0)) / M_PI) / 2.0;
+    m_focus = std::make_pair(u, v);
+
+    for(Queued& queued in m_queue)
+      queued.distance = distanceTo(queued.key);
+    std::make_heap(m_queue.begin(), m_queue.end(), later);
+  }
+
+  void TileScheduler::setSkipPredicate(std::function<bool(TileKey)> predicate) { m_skip = std::move(predicate); }
+
+  int TileScheduler::addJob(TileKey key)
+  {
+    int id = m_next_job++;
+    m_jobs.emplace(id, Job{ std::nullopt, 1, 0 });
+    m_total++;
+    this->enqueue(id, key);
+    return id;
+  }
+
+  int TileScheduler::addJob(const TileCoverage& coverage, int min_zoom, int max_zoom)
+  {
+    int id = m_next_job++;
+    uint64_t total = coverage.count(min_zoom, max_zoom);
+    if(total == 0)
+      return id;
+
+    m_jobs.emplace(id, Job{ coverage.cursor(min_zoom, max_zoom), total, 0 });
+    m_total += total;
+    return id;
+  }
+
+  vector<int> TileScheduler::jobs() const
+  {
+    vector<int> ret;
+    for(const auto& job in m_jobs)
+      ret.push_back(job.first);
+    return ret;
+  }
+
+  void TileScheduler::cancel(int job)
+  {
+    auto it = m_jobs.find(job);
+    if(it == m_jobs.end())
+      return;
+
+    m_total -= it->second.total - it->second.finished;
+    m_jobs.erase(it);
+
+    // Only tiles outstanding (queued, in flight or waiting for a retry) are known, so this stays small.
+    for(auto known = m_known.begin(); known != m_known.end(); known++)
+      known->erase(std::remove(known->begin(), known->end(), job), known->end());
+
+    // Queued tiles another job waits on are handed over to it instead of being dropped.
+    vector<Queued> kept;
+    kept.reserve(m_queue.size());
+    for(Queued& queued in m_queue)
+    {
+      if(queued.job != job)
+        kept.push_back(queued);
+      else if(not m_known.value(queued.key).empty())
+      {
+        queued.job = m_known.value(queued.key).front();
+        kept.push_back(queued);
+      }
+      else
+        m_known.remove(queued.key);
+    }
+    m_queue.swap(kept);
+    std::make_heap(m_queue.begin(), m_queue.end(), later);
+  }
+
+  // Jobs are erased only when cancelled or when nothing of theirs is outstanding.
+  bool TileScheduler::isCancelled(int job) const { return m_jobs.find(job) == m_jobs.end(); }
+
+  /// False once every job waiting on the tile is cancelled, its request may then be aborted.
+  bool TileScheduler::isWanted(TileKey key) const
+  {
+    auto it = m_known.constFind(key);
+    return it != m_known.cend() and not it->empty();
+  }
+
+  std::optional<TileScheduler::Request> TileScheduler::take()
+  {
+    if(m_in_flight >= m_concurrency)
+      return std::nullopt;
+
+    this->refill();
+    if(m_queue.empty())
+      return std::nullopt;
+
+    std::pop_heap(m_queue.begin(), m_queue.end(), later);
+    Queued queued = m_queue.back();
+    m_queue.pop_back();
+    m_in_flight++;
+    return Request{ queued.key, queued.job, queued.attempt };
+  }
+
+  bool TileScheduler::refillPending() const noexcept
+  {
+    return m_refill_cut and m_queue.empty() and m_in_flight < m_concurrency;
+  }
+
+  /// Returns backoff delay in ms when the request should be retried with requeue(), -1 otherwise.
+  int TileScheduler::complete(const Request& request, Result result, qint64 latency)
+  {
+    m_in_flight--;
+    if(not isWanted(request.key))
+    {
+      m_known.remove(request.key);
+      return -1;
+    }
+
+    // Aborted by a cancel, but another job asked for the tile meanwhile.
+    if(result == Result::Cancelled)
+    {
+      this->push(request.key, m_known.value(request.key).front(), request.attempt);
+      return -1;
+    }
+
+    this->adapt(result, latency);
+    if(result == Result::RetryableFailure and request.attempt + 1 < m_limits.max_attempts)
+    {
+      m_waiting++;
+      double delay = std::min<double>(m_limits.max_backoff, m_limits.base_backoff * std::ldexp(1.0, request.attempt));
+      return static_cast<int>(delay * std::uniform_real_distribution<double>(0.75, 1.25)(m_random));
+    }
+
+    this->settle(request.key, result);
+    return -1;
+  }
+
+  void TileScheduler::requeue(const Request& request)
+  {
+    m_waiting--;
+    if(not isWanted(request.key))
+    {
+      m_known.remove(request.key);
+      return;
+    }
+    this->push(request.key, m_known.value(request.key).front(), request.attempt + 1);
+  }
+
+  bool TileScheduler::isIdle() const noexcept
+  {
+    return m_in_flight == 0 and m_waiting == 0 and m_queue.empty() and m_jobs.empty();
+  }
+
+  void TileScheduler::resetCounters() noexcept
+  {
+    m_total = 0;
+    m_completed = 0;
+    m_failed = 0;
+    m_skipped = 0;
+  }
+
+  int TileScheduler::concurrency() const noexcept { return m_concurrency; }
+  int TileScheduler::inFlight() const noexcept { return m_in_flight; }
+  size_t TileScheduler::queued() const noexcept { return m_queue.size(); }
+  double TileScheduler::latency() const noexcept { return m_latency; }
+  uint64_t TileScheduler::total() const noexcept { return m_total; }
+  uint64_t TileScheduler::completed() const noexcept { return m_completed; }
+  uint64_t TileScheduler::failed() const noexcept { return m_failed; }
+  uint64_t TileScheduler::skipped() const noexcept { return m_skipped; }
+  uint64_t TileScheduler::finished() const noexcept { return m_completed + m_failed + m_skipped; }
+
+  bool TileScheduler::later(const Queued& a, const Queued& b) noexcept
+  {
+    if(a.zoom != b.zoom)
+      return a.zoom > b.zoom;
+    if(a.distance != b.distance)
+      return a.distance > b.distance;
+    return a.sequence > b.sequence;
+  }
+
+  void TileScheduler::refill()
+  {
+    m_skip_checks = 0;
+    m_refill_cut = false;
+    while(m_queue.size() < WINDOW)
+    {
+      auto it = std::find_if(m_jobs.begin(), m_jobs.end(), [](const auto& job) { return job.second.cursor.has_value(); });
+      if(it == m_jobs.end())
+        return;
+
+      // An area already stored is skipped tile by tile, leave the rest of it to the next take().
+      if(m_skip_checks >= SKIP_CHECKS)
+      {
+        m_refill_cut = true;
+        return;
+      }
+
+      int zoom, x, y;
+      int id = it->first;
+      Job& job = it->second;
+      bool ok = job.cursor->next(zoom, x, y);
+      if(job.cursor->atEnd())
+        job.cursor.reset();
+      if(ok)
+        this->enqueue(id, packTileKey(zoom, x, y));
+    }
+  }
+
+  void TileScheduler::enqueue(int job, TileKey key)
+  {
+    auto known = m_known.find(key);
+    if(known != m_known.end() and not known->empty())
+    {
+      known->push_back(job);
+      return;
+    }
+
+    if(m_skip)
+    {
+      m_skip_checks++;
+      if(m_skip(key))
+      {
+        m_skipped++;
+        this->finish(job);
+        return;
+      }
+    }
+
+    // A tile whose jobs were all cancelled while its request was still out is adopted by
+    // this job; complete() or requeue() carries that request on.
+    bool outstanding = known != m_known.end();
+    m_known[key] = { job };
+    if(not outstanding)
+      this->push(key, job, 0);
+  }
+
+  void TileScheduler::push(TileKey key, int job, int attempt)
+  {
+    m_queue.push_back({ key, job, attempt, tileKeyZoom(key), distanceTo(key), m_sequence++ });
+    std::push_heap(m_queue.begin(), m_queue.end(), later);
+  }
+
+  void TileScheduler::finish(int job)
+  {
+    auto it = m_jobs.find(job);
+    if(it == m_jobs.end())
+      return;
+    if(++it->second.finished >= it->second.total and not it->second.cursor)
+      m_jobs.erase(it);
+  }
+
+  /// Final outcome of a tile, counted once for every job that waited on it.
+  void TileScheduler::settle(TileKey key, Result result)
+  {
+    vector<int> jobs = m_known.take(key);
+    for(int job in jobs)
+    {
+      if(result == Result::Success)
+        m_completed++;
+      else
+        m_failed++;
+      this->finish(job);
+    }
+  }
+
+  void TileScheduler::adapt(Result result, qint64 latency) noexcept
+  {
+    if(result == Result::PermanentFailure or result == Result::Cancelled)
+      return;
+
+    if(result == Result::RetryableFailure)
+    {
+      m_concurrency = std::max(m_limits.min_parallel, m_concurrency / 2);
+      m_streak = 0;
+      return;
+    }
+
+    m_latency = (m_latency <= 0) ? static_cast<double>(latency) : 0.8 * m_latency + 0.2 * static_cast<double>(latency);
+    if(latency > 2 * m_limits.target_latency)
+    {
+      m_concurrency = std::max(m_limits.min_parallel, m_concurrency - 1);
+      m_streak = 0;
+    }
+    else if(latency <= m_limits.target_latency and ++m_streak >= m_concurrency)
+    {
+      m_concurrency = std::min(m_limits.max_parallel, m_concurrency + 1);
+      m_streak = 0;
+    }
+  }
+
+  double TileScheduler::distanceTo(TileKey key) const noexcept
+  {
+    if(not m_focus)
+      return 0;
+
+    double scale = std::ldexp(1.0, -tileKeyZoom(key));
+    double du = (tileKeyX(key) + 0.5) * scale - m_focus->first;
+    double dv = (tileKeyY(key) + 0.5) * scale - m_focus->second;
+    return du * du + dv * dv;
+  }
+} // CCL
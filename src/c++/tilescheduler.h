@@ -0,0 +1,146 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <random>
+#include <vector>
+#include <QtCore/QHash>
+#include "tilecoverage.h"
+#include "tilestorage.h"
+
+using std::vector;
+
+namespace CCL
+{
+  /**
+   * Download bookkeeping for TileLoader, free of any networking.
+   * Tiles are served lowest zoom first, then nearest to the focus point.
+   * Parallelism follows AIMD: it grows by one after a full window of fast replies
+   * and is halved on transient errors. Area jobs are pulled lazily from their
+   * coverage cursor into a bounded priority window. A tile already queued or in
+   * flight for another job is not requested twice: the later job waits on the
+   * outstanding request and finishes with it. Each take() runs the skip predicate
+   * at most SKIP_CHECKS times; when that budget ran out before anything could be
+   * queued, refillPending() tells the caller to take() again on a later turn.
+   */
+  class TileScheduler
+  {
+    constexpr static const size_t WINDOW = 512;
+    constexpr static const int SKIP_CHECKS = 256;   ///< skip predicate calls per take(), it may hit storage
+
+    public:
+      enum class Result
+      {
+        Success,
+        RetryableFailure,
+        PermanentFailure,
+        Cancelled         ///< aborted on cancel(), never counted
+      };
+
+      struct Request
+      {
+        TileKey key;
+        int job;
+        int attempt;
+      };
+
+      struct Limits
+      {
+        int min_parallel;
+        int max_parallel;
+        int max_attempts;
+        int base_backoff;     ///< ms
+        int max_backoff;      ///< ms
+        int target_latency;   ///< ms
+      };
+
+      TileScheduler();
+
+      [[nodiscard]] const Limits& limits() const noexcept;
+      void setLimits(const Limits& limits);
+      void setFocus(double latitude, double longitude);
+      void setSkipPredicate(std::function<bool(TileKey)> predicate);
+
+      int addJob(TileKey key);
+      int addJob(const TileCoverage& coverage, int min_zoom, int max_zoom);
+      [[nodiscard]] vector<int> jobs() const;
+      void cancel(int job);
+      [[nodiscard]] bool isCancelled(int job) const;
+      [[nodiscard]] bool isWanted(TileKey key) const;
+
+      [[nodiscard]] std::optional<Request> take();
+      [[nodiscard]] bool refillPending() const noexcept;
+      int complete(const Request& request, Result result, qint64 latency);
+      void requeue(const Request& request);
+
+      [[nodiscard]] bool isIdle() const noexcept;
+      void resetCounters() noexcept;
+
+      [[nodiscard]] int concurrency() const noexcept;
+      [[nodiscard]] int inFlight() const noexcept;
+      [[nodiscard]] size_t queued() const noexcept;
+      [[nodiscard]] double latency() const noexcept;
+      [[nodiscard]] uint64_t total() const noexcept;
+      [[nodiscard]] uint64_t completed() const noexcept;
+      [[nodiscard]] uint64_t failed() const noexcept;
+      [[nodiscard]] uint64_t skipped() const noexcept;
+      [[nodiscard]] uint64_t finished() const noexcept;
+
+    private:
+      struct Queued
+      {
+        TileKey key;
+        int job;
+        int attempt;
+        int zoom;
+        double distance;
+        uint64_t sequence;
+      };
+
+      struct Job
+      {
+        std::optional<TileCoverage::Cursor> cursor;
+        uint64_t total;
+        uint64_t finished;
+      };
+
+      static bool later(const Queued& a, const Queued& b) noexcept;
+      void refill();
+      void enqueue(int job, TileKey key);
+      void push(TileKey key, int job, int attempt);
+      void finish(int job);
+      void settle(TileKey key, Result result);
+      void adapt(Result result, qint64 latency) noexcept;
+      [[nodiscard]] double distanceTo(TileKey key) const noexcept;
+
+    private:
+      Limits m_limits;
+      std::map<int, Job> m_jobs;
+      vector<Queued> m_queue;
+      QHash<TileKey, vector<int>> m_known;   ///< jobs waiting on each queued or in-flight tile
+      std::function<bool(TileKey)> m_skip;
+      std::minstd_rand m_random;
+      std::optional<std::pair<double, double>> m_focus;
+      int m_next_job;
+      uint64_t m_sequence;
+      int m_skip_checks;    ///< skip predicate calls by the current refill
+      bool m_refill_cut;    ///< last refill stopped on the skip check budget
+      int m_concurrency;
+      int m_in_flight;
+      int m_waiting;
+      int m_streak;
+      double m_latency;
+      uint64_t m_total;
+      uint64_t m_completed;
+      uint64_t m_failed;
+      uint64_t m_skipped;
+  };
+} // CCL
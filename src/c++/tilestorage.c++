@@ -0,0 +1,490 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "tilestorage.h"
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <QtCore/QtEndian>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QSaveFile>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define in :
+
+namespace
+{
+  constexpr const char PACK_MAGIC[8] = { 'C', 'C', 'L', 'T', 'P', 'A', 'K', '2' };
+  constexpr const char INDEX_MAGIC[8] = { 'C', 'C', 'L', 'T', 'I', 'D', 'X', '1' };
+  constexpr const char* INDEX_SUFFIX = ".idx";
+  constexpr const uint32_t RECORD_MAGIC = 0x4345'5243;    // "CREC", never all zero like a preallocated tail
+
+  constexpr const qint64 PACK_HEADER_SIZE = sizeof(PACK_MAGIC) + sizeof(quint64);     ///< magic, pack id
+  constexpr const qint64 INDEX_HEADER_SIZE = sizeof(INDEX_MAGIC) + sizeof(quint64);   ///< magic, pack id
+  constexpr const qint64 INDEX_BLOCK_HEADER_SIZE = 12;                                ///< entry count, covered pack length
+  constexpr const qint64 INDEX_ENTRY_SIZE = 20;                                       ///< key, payload offset, size
+
+  struct RecordHeader
+  {
+    uint32_t magic;
+    uint32_t x;
+    uint32_t y;
+    uint32_t size;
+    uint32_t crc;         ///< CRC-32 of the header with this field zeroed, then of the payload
+    uint8_t zoom;
+    uint8_t reserved[3];
+  };
+  static_assert(sizeof(RecordHeader) == 24);
+
+  constexpr const std::array<uint32_t, 256> CRC_TABLE = []() {
+    std::array<uint32_t, 256> ret = {};
+    for(uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t crc = i;
+      for(int bit = 0; bit < 8; bit++)
+        crc = (crc & 1) ? (crc >> 1) ^ 0xEDB8'8320 : crc >> 1;
+      ret[i] = crc;
+    }
+    return ret;
+  }();
+
+  /// CRC-32 (IEEE 802.3). Chains: crc32(crc32(0, a), b) is the checksum of a followed by b.
+  uint32_t crc32(uint32_t crc, const uchar* data, qint64 size) noexcept
+  {
+    crc = ~crc;
+    for(qint64 i = 0; i < size; i++)
+      crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+  }
+
+  RecordHeader decodeHeader(const uchar* raw) noexcept
+  {
+    RecordHeader ret = {};
+    ret.magic = qFromLittleEndian<quint32>(raw);
+    ret.x = qFromLittleEndian<quint32>(raw + 4);
+    ret.y = qFromLittleEndian<quint32>(raw + 8);
+    ret.size = qFromLittleEndian<quint32>(raw + 12);
+    ret.crc = qFromLittleEndian<quint32>(raw + 16);
+    ret.zoom = raw[20];
+    return ret;
+  }
+
+  void encodeHeader(const RecordHeader& header, uchar* raw) noexcept
+  {
+    std::memset(raw, 0, sizeof(RecordHeader));
+    qToLittleEndian<quint32>(header.magic, raw);
+    qToLittleEndian<quint32>(header.x, raw + 4);
+    qToLittleEndian<quint32>(header.y, raw + 8);
+    qToLittleEndian<quint32>(header.size, raw + 12);
+    qToLittleEndian<quint32>(header.crc, raw + 16);
+    raw[20] = header.zoom;
+  }
+
+  /// Checksum stored in a record header, computed over the encoded header and its payload.
+  uint32_t recordChecksum(RecordHeader header, const uchar* payload) noexcept
+  {
+    uchar raw[sizeof(RecordHeader)];
+    header.crc = 0;
+    encodeHeader(header, raw);
+    return crc32(crc32(0, raw, sizeof(raw)), payload, header.size);
+  }
+
+  void syncToDisk(QFile& file)
+  {
+    file.flush();
+    #if defined(Q_OS_WIN)
+    _commit(file.handle());
+    #else
+    ::fsync(file.handle());
+    #endif
+  }
+} // namespace
+
+namespace CCL
+{
+  DirectoryTileStorage::DirectoryTileStorage(QString root)
+    : m_root(std::move(root))
+  {}
+
+  bool DirectoryTileStorage::contains(int zoom, int x, int y) const
+  {
+    return QFile::exists(m_root + QString("/%1/%2/%3").arg(zoom).arg(x).arg(y));
+  }
+
+  QByteArray DirectoryTileStorage::read(int zoom, int x, int y) const
+  {
+    QByteArray ret;
+    QFile tileFile(m_root + QString("/%1/%2/%3").arg(zoom).arg(x).arg(y));
+    if(tileFile.open(QIODevice::ReadOnly))
+    {
+      ret = tileFile.readAll();
+      tileFile.close();
+    }
+
+    return ret;
+  }
+
+  void DirectoryTileStorage::write(int zoom, int x, int y, const QByteArray& data)
+  {
+    QString directory = m_root + QString("/%1/%2").arg(zoom).arg(x);
+    if(not m_known_directories.contains(directory))
+    {
+      QDir().mkpath(directory);
+      m_known_directories.insert(directory);
+    }
+
+    // Written aside and renamed into place: prefetch reads from a worker thread must never see half a tile.
+    QSaveFile tileFile(directory + QString("/%1").arg(y));
+    if(tileFile.open(QIODevice::WriteOnly))
+    {
+      tileFile.write(data);
+      tileFile.commit();
+    }
+  }
+
+  PackedTileStorage::PackedTileStorage(const QString& path, qint64 batch_bytes, int batch_count, qint64 map_window)
+    : m_file(path)
+    , m_index_file(path + INDEX_SUFFIX)
+    , m_pack_id(0)
+    , m_mapped_end(0)
+    , m_pending_bytes(0)
+    , m_batch_bytes(batch_bytes)
+    , m_batch_count(batch_count)
+    , m_map_window(map_window)
+  {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    if(not m_file.open(QIODevice::ReadWrite))
+      throw std::runtime_error("CCL.PackedTileStorage: failed to open " + path.toStdString());
+
+    // The index only saves the scan on open, the pack stays usable without it.
+    if(not m_index_file.open(QIODevice::ReadWrite))
+      qWarning() << "CCL.PackedTileStorage: failed to open" << m_index_file.fileName() << ":" << m_index_file.errorString();
+    this->load();
+  }
+
+  PackedTileStorage::~PackedTileStorage()
+  {
+    QMutexLocker lock(&m_mutex);
+    this->flushLocked();
+  }
+
+  bool PackedTileStorage::contains(int zoom, int x, int y) const
+  {
+    QMutexLocker lock(&m_mutex);
+    TileKey key = packTileKey(zoom, x, y);
+    return m_pending.contains(key) or m_index.contains(key);
+  }
+
+  QByteArray PackedTileStorage::read(int zoom, int x, int y) const
+  {
+    QMutexLocker lock(&m_mutex);
+    TileKey key = packTileKey(zoom, x, y);
+    auto pending = m_pending.constFind(key);
+    if(pending != m_pending.cend())
+      return pending.value();
+
+    auto entry = m_index.constFind(key);
+    if(entry == m_index.cend())
+      return {};
+    if(entry->data != nullptr)
+      return QByteArray::fromRawData(entry->data, static_cast<int>(entry->size));
+
+    // Flushed after the last mapped window.
+    if(not m_file.seek(entry->offset))
+      return {};
+    return m_file.read(entry->size);
+  }
+
+  void PackedTileStorage::write(int zoom, int x, int y, const QByteArray& data)
+  {
+    QMutexLocker lock(&m_mutex);
+    TileKey key = packTileKey(zoom, x, y);
+    if(not m_pending.contains(key))
+      m_pending_order.push_back(key);
+    else
+      m_pending_bytes -= m_pending[key].size();
+    m_pending.insert(key, data);
+    m_pending_bytes += data.size();
+
+    if(m_pending_bytes >= m_batch_bytes or static_cast<int>(m_pending_order.size()) >= m_batch_count)
+      this->flushLocked();
+  }
+
+  void PackedTileStorage::flush()
+  {
+    QMutexLocker lock(&m_mutex);
+    this->flushLocked();
+  }
+
+  int PackedTileStorage::size() const
+  {
+    QMutexLocker lock(&m_mutex);
+    int ret = m_index.size();
+    for(TileKey key in m_pending_order)
+      if(not m_index.contains(key))
+        ret++;
+    return ret;
+  }
+
+  void PackedTileStorage::load()
+  {
+    qint64 file_size = m_file.size();
+    if(file_size < PACK_HEADER_SIZE)
+    {
+      uchar header[PACK_HEADER_SIZE];
+      m_pack_id = QRandomGenerator::global()->generate64();
+      std::memcpy(header, PACK_MAGIC, sizeof(PACK_MAGIC));
+      qToLittleEndian<quint64>(m_pack_id, header + sizeof(PACK_MAGIC));
+      m_file.resize(0);
+      m_file.seek(0);
+      m_file.write(reinterpret_cast<const char*>(header), PACK_HEADER_SIZE);
+      syncToDisk(m_file);
+      m_mapped_end = PACK_HEADER_SIZE;
+      this->rewriteIndex();
+      return;
+    }
+
+    uchar* base = m_file.map(0, file_size);
+    if(base == nullptr or std::memcmp(base, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0)
+      throw std::runtime_error("CCL.PackedTileStorage: " + m_file.fileName().toStdString() + " is not a tile pack");
+    m_pack_id = qFromLittleEndian<quint64>(base + sizeof(PACK_MAGIC));
+
+    // Only records appended after the last index block are walked, all of them if the index is unusable.
+    const qint64 indexed = this->loadIndex(base, file_size);
+    qint64 offset = indexed;
+    vector<TileKey> scanned;
+    while(offset + static_cast<qint64>(sizeof(RecordHeader)) <= file_size)
+    {
+      RecordHeader header = decodeHeader(base + offset);
+      qint64 payload = offset + static_cast<qint64>(sizeof(RecordHeader));
+      if(header.magic != RECORD_MAGIC or payload + header.size > file_size or recordChecksum(header, base + payload) != header.crc)
+        break;
+
+      TileKey key = packTileKey(header.zoom, static_cast<int>(header.x), static_cast<int>(header.y));
+      m_index.insert(key, { payload, header.size, reinterpret_cast<const char*>(base + payload) });
+      scanned.push_back(key);
+      offset = payload + header.size;
+    }
+
+    // Torn or zero-filled tail from an interrupted batch, drop it so new records stay aligned.
+    if(offset != file_size)
+      m_file.resize(offset);
+    m_mapped_end = offset;
+
+    if(indexed == PACK_HEADER_SIZE)
+      this->rewriteIndex();
+    else if(not scanned.empty())
+      this->appendIndex(scanned, offset);
+  }
+
+  /**
+   * Side file layout: magic and pack id, then one block per flush of
+   * (entry count, covered pack length, entries, CRC-32 of the block).
+   * Blocks are accepted in order while intact and within the pack, the
+   * index is cut back to the first one that is not. Returns the pack
+   * length the accepted blocks cover, the header size if none are usable.
+   */
+  qint64 PackedTileStorage::loadIndex(const uchar* base, qint64 file_size)
+  {
+    if(not m_index_file.seek(0))
+      return PACK_HEADER_SIZE;
+    const QByteArray index = m_index_file.readAll();
+    const auto* raw = reinterpret_cast<const uchar*>(index.constData());
+    if(index.size() < INDEX_HEADER_SIZE or std::memcmp(raw, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+       or qFromLittleEndian<quint64>(raw + sizeof(INDEX_MAGIC)) != m_pack_id)
+      return PACK_HEADER_SIZE;
+
+    qint64 ret = PACK_HEADER_SIZE;
+    qint64 position = INDEX_HEADER_SIZE;
+    while(position + INDEX_BLOCK_HEADER_SIZE <= index.size())
+    {
+      const uchar* block = raw + position;
+      const qint64 count = qFromLittleEndian<quint32>(block);
+      const qint64 end = static_cast<qint64>(qFromLittleEndian<quint64>(block + 4));
+      const qint64 block_size = INDEX_BLOCK_HEADER_SIZE + count * INDEX_ENTRY_SIZE + static_cast<qint64>(sizeof(quint32));
+      if(position + block_size > index.size() or end < ret or end > file_size
+         or crc32(0, block, block_size - 4) != qFromLittleEndian<quint32>(block + block_size - 4))
+        break;
+
+      for(const uchar* entry = block + INDEX_BLOCK_HEADER_SIZE; entry < block + block_size - 4; entry += INDEX_ENTRY_SIZE)
+      {
+        const TileKey key = qFromLittleEndian<quint64>(entry);
+        const qint64 offset = static_cast<qint64>(qFromLittleEndian<quint64>(entry + 8));
+        const uint32_t size = qFromLittleEndian<quint32>(entry + 16);
+        if(offset < PACK_HEADER_SIZE + static_cast<qint64>(sizeof(RecordHeader)) or offset + size > end)
+        {
+          m_index.clear();
+          return PACK_HEADER_SIZE;
+        }
+        m_index.insert(key, { offset, size, reinterpret_cast<const char*>(base + offset) });
+      }
+      ret = end;
+      position += block_size;
+    }
+
+    if(position != index.size())
+      m_index_file.resize(position);
+    return ret;
+  }
+
+  void PackedTileStorage::rewriteIndex()
+  {
+    uchar header[INDEX_HEADER_SIZE];
+    std::memcpy(header, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    qToLittleEndian<quint64>(m_pack_id, header + sizeof(INDEX_MAGIC));
+    if(not m_index_file.resize(0) or not m_index_file.seek(0)
+       or m_index_file.write(reinterpret_cast<const char*>(header), INDEX_HEADER_SIZE) != INDEX_HEADER_SIZE)
+    {
+      qWarning() << "CCL.PackedTileStorage: failed to write" << m_index_file.fileName() << ":" << m_index_file.errorString();
+      return;
+    }
+
+    vector<TileKey> keys;
+    keys.reserve(static_cast<size_t>(m_index.size()));
+    for(auto it = m_index.cbegin(); it != m_index.cend(); it++)
+      keys.push_back(it.key());
+    this->appendIndex(keys, m_mapped_end);
+  }
+
+  /// Not fsynced: the pack is synced before and a lost block only costs a rescan of its records.
+  void PackedTileStorage::appendIndex(const vector<TileKey>& keys, qint64 end)
+  {
+    QByteArray block(static_cast<int>(INDEX_BLOCK_HEADER_SIZE + static_cast<qint64>(keys.size()) * INDEX_ENTRY_SIZE + 4), '\0');
+    auto* raw = reinterpret_cast<uchar*>(block.data());
+    qToLittleEndian<quint32>(static_cast<quint32>(keys.size()), raw);
+    qToLittleEndian<quint64>(static_cast<quint64>(end), raw + 4);
+    uchar* entry = raw + INDEX_BLOCK_HEADER_SIZE;
+    for(TileKey key in keys)
+    {
+      const Entry& indexed = m_index[key];
+      qToLittleEndian<quint64>(key, entry);
+      qToLittleEndian<quint64>(static_cast<quint64>(indexed.offset), entry + 8);
+      qToLittleEndian<quint32>(indexed.size, entry + 16);
+      entry += INDEX_ENTRY_SIZE;
+    }
+    qToLittleEndian<quint32>(crc32(0, raw, block.size() - 4), entry);
+
+    qint64 start = m_index_file.size();
+    if(not m_index_file.seek(start) or m_index_file.write(block) != block.size())
+    {
+      qWarning() << "CCL.PackedTileStorage: failed to append to" << m_index_file.fileName() << ":" << m_index_file.errorString();
+      m_index_file.resize(start);
+    }
+  }
+
+  bool PackedTileStorage::flushLocked()
+  {
+    if(m_pending_order.empty())
+      return true;
+
+    qint64 start = m_file.size();
+    QByteArray batch;
+    batch.reserve(static_cast<int>(m_pending_bytes + m_pending_order.size() * sizeof(RecordHeader)));
+    vector<Entry> entries;
+    entries.reserve(m_pending_order.size());
+    for(TileKey key in m_pending_order)
+    {
+      const QByteArray& data = m_pending[key];
+      RecordHeader header = {};
+      header.magic = RECORD_MAGIC;
+      header.zoom = static_cast<uint8_t>(tileKeyZoom(key));
+      header.x = static_cast<uint32_t>(tileKeyX(key));
+      header.y = static_cast<uint32_t>(tileKeyY(key));
+      header.size = static_cast<uint32_t>(data.size());
+      header.crc = recordChecksum(header, reinterpret_cast<const uchar*>(data.constData()));
+
+      uchar raw[sizeof(RecordHeader)];
+      encodeHeader(header, raw);
+      batch.append(reinterpret_cast<const char*>(raw), sizeof(raw));
+      entries.push_back({ start + batch.size(), header.size, nullptr });
+      batch.append(data);
+    }
+
+    // Runs from the network slot and the destructor, so failure is reported rather than thrown:
+    // the partial append is cut off and the batch stays pending for the next flush.
+    if(not m_file.seek(start) or m_file.write(batch) != batch.size())
+    {
+      qWarning() << "CCL.PackedTileStorage: failed to append to" << m_file.fileName() << ":" << m_file.errorString();
+      m_file.resize(start);
+      return false;
+    }
+    syncToDisk(m_file);
+
+    for(size_t i = 0; i < entries.size(); i++)
+      m_index.insert(m_pending_order[i], entries[i]);
+    m_unmapped.insert(m_unmapped.end(), m_pending_order.cbegin(), m_pending_order.cend());
+    this->appendIndex(m_pending_order, m_file.size());
+    m_pending.clear();
+    m_pending_order.clear();
+    m_pending_bytes = 0;
+
+    if(m_file.size() - m_mapped_end >= m_map_window)
+      this->mapTail();
+    return true;
+  }
+
+  void PackedTileStorage::mapTail()
+  {
+    // Windows are never unmapped, so arrays handed out by read() stay valid. Mapping in large
+    // windows keeps the mapping count far below vm.max_map_count even for huge packs.
+    qint64 end = m_file.size();
+    uchar* base = m_file.map(m_mapped_end, end - m_mapped_end);
+    if(base == nullptr)
+    {
+      qWarning() << "CCL.PackedTileStorage: failed to map" << m_file.fileName() << ":" << m_file.errorString();
+      return;
+    }
+
+    for(TileKey key in m_unmapped)
+    {
+      Entry& entry = m_index[key];
+      if(entry.data == nullptr and entry.offset >= m_mapped_end)
+        entry.data = reinterpret_cast<const char*>(base + (entry.offset - m_mapped_end));
+    }
+    m_unmapped.clear();
+    m_mapped_end = end;
+  }
+
+  qint64 importDirectoryStorage(const QString& root, TileStorage& target)
+  {
+    qint64 ret = 0;
+    QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+    while(it.hasNext())
+    {
+      QString path = it.next();
+      QStringList parts = QDir(root).relativeFilePath(path).split('/');
+      if(parts.size() != 3)
+        continue;
+
+      bool ok_z, ok_x, ok_y;
+      int zoom = parts[0].toInt(&ok_z);
+      int x = parts[1].toInt(&ok_x);
+      int y = parts[2].toInt(&ok_y);
+      if(not ok_z or not ok_x or not ok_y)
+        continue;
+
+      QFile tileFile(path);
+      if(not tileFile.open(QIODevice::ReadOnly))
+        continue;
+      target.write(zoom, x, y, tileFile.readAll());
+      ret++;
+    }
+
+    target.flush();
+    return ret;
+  }
+} // CCL
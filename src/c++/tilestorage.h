@@ -0,0 +1,123 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+using std::vector;
+
+namespace CCL
+{
+  using TileKey = uint64_t;
+
+  constexpr TileKey packTileKey(int zoom, int x, int y) noexcept
+  {
+    return (static_cast<uint64_t>(zoom) << 58) | (static_cast<uint64_t>(x) << 29) | static_cast<uint64_t>(y);
+  }
+
+  constexpr int tileKeyZoom(TileKey key) noexcept { return static_cast<int>(key >> 58); }
+  constexpr int tileKeyX(TileKey key) noexcept { return static_cast<int>((key >> 29) & 0x1FFF'FFFF); }
+  constexpr int tileKeyY(TileKey key) noexcept { return static_cast<int>(key & 0x1FFF'FFFF); }
+
+  /// Tile persistence backend used by TileLoader.
+  class TileStorage
+  {
+    public:
+      virtual ~TileStorage() = default;
+
+      [[nodiscard]] virtual bool contains(int zoom, int x, int y) const = 0;
+      [[nodiscard]] virtual QByteArray read(int zoom, int x, int y) const = 0;
+      virtual void write(int zoom, int x, int y, const QByteArray& data) = 0;
+      virtual void flush() {}
+  };
+
+  /// One file per tile at root/z/x/y, the historical TileLoader layout.
+  class DirectoryTileStorage : public TileStorage
+  {
+    public:
+      explicit DirectoryTileStorage(QString root);
+
+      [[nodiscard]] bool contains(int zoom, int x, int y) const override;
+      [[nodiscard]] QByteArray read(int zoom, int x, int y) const override;
+      void write(int zoom, int x, int y, const QByteArray& data) override;
+
+    private:
+      QString m_root;
+      QSet<QString> m_known_directories;
+  };
+
+  /**
+   * Single append-only file of (header, payload) records with an in-memory hashed index.
+   * The file is memory-mapped on open and then in windows of at least map_window bytes as
+   * it grows; read() returns QByteArrays referencing the mapping without copying, and they
+   * stay valid for the lifetime of the storage object only. Records flushed after the last
+   * window are read through the file until the next window is mapped.
+   * Writes are buffered and appended + fsynced in batches. A failed append is rolled back
+   * and kept pending for the next flush. Every record carries a magic and a CRC-32; on open
+   * the first record failing them ends the pack and it is truncated there, which drops torn
+   * or zero-filled tails left by a crash.
+   * The index is persisted next to the pack as path + ".idx", one block per flush. Open reads
+   * it instead of walking the records, checks it belongs to this pack and covers no more than
+   * the file holds, and scans only what it does not cover. A missing, foreign or damaged index
+   * falls back to the full scan and is rewritten.
+   */
+  class PackedTileStorage : public TileStorage
+  {
+    public:
+      explicit PackedTileStorage(const QString& path, qint64 batch_bytes = 4 * 1024 * 1024, int batch_count = 256,
+                                 qint64 map_window = 256 * 1024 * 1024);
+      ~PackedTileStorage() override;
+
+      [[nodiscard]] bool contains(int zoom, int x, int y) const override;
+      [[nodiscard]] QByteArray read(int zoom, int x, int y) const override;
+      void write(int zoom, int x, int y, const QByteArray& data) override;
+      void flush() override;
+
+      [[nodiscard]] int size() const;
+
+    private:
+      void load();
+      qint64 loadIndex(const uchar* base, qint64 file_size);
+      void rewriteIndex();
+      void appendIndex(const vector<TileKey>& keys, qint64 end);
+      bool flushLocked();
+      void mapTail();
+
+    private:
+      struct Entry
+      {
+        qint64 offset;
+        uint32_t size;
+        const char* data;
+      };
+
+      mutable QMutex m_mutex;
+      mutable QFile m_file;
+      QFile m_index_file;
+      quint64 m_pack_id;      ///< random per pack, ties the index file to it
+      QHash<TileKey, Entry> m_index;
+      vector<TileKey> m_unmapped;
+      qint64 m_mapped_end;
+      QHash<TileKey, QByteArray> m_pending;
+      vector<TileKey> m_pending_order;
+      qint64 m_pending_bytes;
+      qint64 m_batch_bytes;
+      int m_batch_count;
+      qint64 m_map_window;
+  };
+
+  /// Copies every tile of a root/z/x/y directory tree into target. Returns imported tile count.
+  qint64 importDirectoryStorage(const QString& root, TileStorage& target);
+} // CCL
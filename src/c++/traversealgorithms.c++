@@ -6,9 +6,11 @@
  * ---------------------------------------------------------------------- */
 
 #include "traversealgorithms.h"
+#include <algorithm>
 #include <vector>
 #include <stdexcept>
 #include <cmath>
+#include <limits>
 #include <QtCore/QPointF>
 #include <QtCore/QLineF>
 #include <QtCore/QRectF>
@@ -16,6 +18,7 @@
 #include <QtPositioning/QGeoPath>
 #include <QtPositioning/QGeoPolygon>
 #include "CCL/Geomath"
+#include "metrics.h"
 
 #define in :
 
@@ -131,108 +134,253 @@ namespace CCL::Traverse
     void reverseTransectOrder(CoordinateArray2D& t) noexcept { std::reverse(t.begin(), t.end()); }
   } // Internal
 
-  QGeoPath buildTraverse(const QGeoPolygon& poly, float angle, float spacing, float turn_around, Entry entry)
+  Planner::Planner(const QGeoPolygon& poly, float angle, float spacing, float turn_around, Entry entry)
+    : m_frame(poly.isEmpty() ? QGeoCoordinate(0, 0) : poly.path().front())
+    , m_cos(std::cos(Internal::clampTraverseGridAngle(angle) * M_PI / 180.0))
+    , m_sin(std::sin(Internal::clampTraverseGridAngle(angle) * M_PI / 180.0))
+    , m_turn_around(turn_around)
+    , m_entry(entry)
   {
-    if(poly.isEmpty())
-      return {};
-
     if(spacing < 0.5f)
-      throw std::invalid_argument("CCL.Traverse.build: spacing is too low (< 0.5)");
+      throw std::invalid_argument("CCL.Traverse.Planner: spacing is too low (< 0.5)");
 
-    QGeoPath ret;
-
-    if(poly.size() < 3)
-    {
-      ret.addCoordinate(poly.path().front());
-      ret.addCoordinate(poly.path().back());
-    }
-    else
+    struct Edge
     {
-      deque<QPointF> poly_points;
-      QGeoCoordinate tg_origin = poly.path().front();
+      double u_min, u_max;
+      double v0;
+      double slope;
+    };
+
+    vector<Edge> edges;
+    vector<double> latitude, longitude, north, east;
+    double u_min = std::numeric_limits<double>::max();
+    double u_max = std::numeric_limits<double>::lowest();
+    auto addRing = [&](const QList<QGeoCoordinate>& ring, bool outer) {
+      if(ring.size() < 3)
+        return;
 
-      bool lf = false;
-      for(const QGeoCoordinate& point in poly.path())
+      latitude.clear();
+      longitude.clear();
+      for(const QGeoCoordinate& point in ring)
       {
-        NEDPoint ned;
-        if(lf)
-          ned = geo2NED(point, tg_origin);
-        else
-          lf = true;
-        poly_points.emplace_back(ned.x, ned.y);
+        latitude.push_back(point.latitude());
+        longitude.push_back(point.longitude());
       }
+      north.resize(latitude.size());
+      east.resize(latitude.size());
+      m_frame.toNED(latitude.size(), latitude.data(), longitude.data(), nullptr, north.data(), east.data(), nullptr);
 
-      float grid_angle = Internal::clampTraverseGridAngle(angle);
-      QPolygonF polygon;
-      for(const QPointF& point in poly_points)
-        polygon << point;
-      polygon << poly_points.front();
-
-      QRectF bounding_rect = polygon.boundingRect();
-      deque<QLineF> lines;
-      float max_w = static_cast<float>(std::max(bounding_rect.width(), bounding_rect.height()) + 2000.0f);
-      float transect_x = static_cast<float>(bounding_rect.center().x() - max_w / 2);
-      while(transect_x < transect_x + max_w)
+      // Rotated frame: v runs along the transects, u across them.
+      for(size_t i = 0; i < north.size(); i++)
       {
-        lines.emplace_back(Internal::rotateTraversePoint({transect_x, bounding_rect.center().y() - max_w / 2}, bounding_rect.center(), grid_angle),
-                           Internal::rotateTraversePoint({transect_x, bounding_rect.center().y() + max_w / 2}, bounding_rect.center(), grid_angle));
-        transect_x += spacing;
+        size_t j = (i + 1) % north.size();
+        double u0 = east[i] * m_cos - north[i] * m_sin;
+        double v0 = east[i] * m_sin + north[i] * m_cos;
+        double u1 = east[j] * m_cos - north[j] * m_sin;
+        double v1 = east[j] * m_sin + north[j] * m_cos;
+        if(outer)
+        {
+          u_min = std::min(u_min, u0);
+          u_max = std::max(u_max, u0);
+        }
+        // Anchored at the lower end, so edges leaving the same vertex cross a transect through it at the same v.
+        if(u0 < u1)
+          edges.push_back({ u0, u1, v0, (v1 - v0) / (u1 - u0) });
+        else if(u1 < u0)
+          edges.push_back({ u1, u0, v1, (v1 - v0) / (u1 - u0) });
       }
+    };
 
-      deque<QLineF> intersection_lines = Internal::findIntersectionWithPolygon(lines, polygon);
-      if(intersection_lines.size() < 2)
+    {
+      CCL_METRIC_SCOPE(TraverseProjection);
+      addRing(poly.path(), true);
+      for(int i = 0; i < poly.holesCount(); i++)
+        addRing(poly.holePath(i), false);
+    }
+    if(edges.empty())
+      return;
+
+    size_t count;
+    double first;
+    {
+      CCL_METRIC_SCOPE(TraverseTransects);
+      std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.u_min < b.u_min; });
+
+      // Transects are centered over the polygon, a polygon narrower than spacing gets one through the middle.
+      count = static_cast<size_t>(std::floor((u_max - u_min) / spacing)) + 1;
+      first = u_min + ((u_max - u_min) - static_cast<double>(count - 1) * spacing) / 2;
+    }
+
+    CCL_METRIC_SCOPE(TraverseIntersection);
+    vector<const Edge*> active;
+    vector<double> crossings;
+    size_t next = 0;
+    m_offsets.push_back(0);
+    for(size_t i = 0; i < count; i++)
+    {
+      double u = first + static_cast<double>(i) * spacing;
+      while(next < edges.size() and edges[next].u_min <= u)
+        active.push_back(&edges[next++]);
+      active.erase(std::remove_if(active.begin(), active.end(), [u](const Edge* e) { return e->u_max <= u; }),
+                   active.end());
+
+      crossings.clear();
+      for(const Edge* edge in active)
+        crossings.push_back(edge->v0 + (u - edge->u_min) * edge->slope);
+      std::sort(crossings.begin(), crossings.end());
+
+      // A vertex whose edges both lie ahead of the transect only touches it: drop the pair
+      // instead of emitting a zero-length segment or splitting the one it lies on.
+      size_t kept = 0;
+      for(size_t c = 0; c < crossings.size(); c++)
       {
-        lines.clear();
-        lines.push_back(QLineF(lines.front()).translated(bounding_rect.center() - lines.front().pointAt(0.5)));
-        intersection_lines = Internal::findIntersectionWithPolygon(lines, polygon);
+        if(kept > 0 and crossings[kept - 1] == crossings[c])
+          kept--;
+        else
+          crossings[kept++] = crossings[c];
       }
+      crossings.resize(kept);
+      if(crossings.size() < 2)
+        continue;
 
-      deque<QLineF> result = Internal::adjustLineDirections(intersection_lines);
-      CoordinateArray2D transects;
-      for(const QLineF& line in result)
+      for(size_t c = 0; c + 1 < crossings.size(); c += 2)
       {
-        deque<QGeoCoordinate> transect;
-        transect.emplace_back(ned2geo({static_cast<float>(line.p1().y()), static_cast<float>(line.p1().x()), 0},
-                                      tg_origin));
-        transect.emplace_back(ned2geo({static_cast<float>(line.p2().y()), static_cast<float>(line.p2().x()), 0},
-                                      tg_origin));
-        transects.push_back(transect);
+        m_spans.push_back(crossings[c]);
+        m_spans.push_back(crossings[c + 1]);
       }
+      m_positions.push_back(u);
+      m_offsets.push_back(m_spans.size() / 2);
+    }
+  }
+
+  size_t Planner::transectCount() const noexcept { return m_positions.size(); }
+  size_t Planner::segmentCount() const noexcept { return m_spans.size() / 2; }
+  size_t Planner::waypointCount() const noexcept { return m_spans.size(); }
 
-      Internal::adjustTransects(transects, entry);
-      bool rv = false;
-      for(CoordinateArray1D& transect in transects)
+  double Planner::pathLength() const noexcept
+  {
+    double ret = 0;
+    bool first = true;
+    double last_east = 0, last_north = 0;
+    this->walk([&](double east, double north) {
+      if(not first)
+        ret += std::hypot(east - last_east, north - last_north);
+      first = false;
+      last_east = east;
+      last_north = north;
+    });
+    return ret;
+  }
+
+  /**
+   * Calls f(east, north) for every waypoint in flight order. Entry picks the starting
+   * corner: Top* enters each first transect from its far end along the azimuth, *Right
+   * starts from the last transect across. Direction alternates per transect.
+   */
+  template<typename F>
+  void Planner::walk(F&& f) const
+  {
+    const size_t count = m_positions.size();
+    const bool reverse_order = m_entry == Entry::TopRight or m_entry == Entry::BottomRight;
+    bool descending = m_entry == Entry::TopLeft or m_entry == Entry::TopRight;
+
+    auto point = [this, &f](double u, double v) { f(u * m_cos + v * m_sin, v * m_cos - u * m_sin); };
+    for(size_t k = 0; k < count; k++)
+    {
+      size_t t = reverse_order ? count - 1 - k : k;
+      double u = m_positions[t];
+      if(descending)
       {
-        CoordinateArray1D transect_vertices = transect;
-        if(rv)
+        for(size_t i = m_offsets[t + 1]; i-- > m_offsets[t];)
         {
-          rv = false;
-          std::reverse(transect_vertices.begin(), transect_vertices.end());
+          point(u, m_spans[2 * i + 1] + m_turn_around);
+          point(u, m_spans[2 * i] - m_turn_around);
         }
-        else
-          rv = true;
-        transect = transect_vertices;
       }
-      QList<QGeoCoordinate> result_path;
-      for(CoordinateArray1D& transect in transects)
+      else
       {
-        double tad = turn_around;
-        if(tad != 0)
+        for(size_t i = m_offsets[t]; i < m_offsets[t + 1]; i++)
         {
-          double azimuth = transect.front().azimuthTo(transect[1]);
-          transect.front() = transect.front().atDistanceAndAzimuth(-tad, azimuth);
-          transect.front().setAltitude(qQNaN());
-          transect[1] = transect[1].atDistanceAndAzimuth(tad, azimuth);
-          transect[1].setAltitude(qQNaN());
+          point(u, m_spans[2 * i] - m_turn_around);
+          point(u, m_spans[2 * i + 1] + m_turn_around);
         }
-
-        for(const QGeoCoordinate& coordinate in transect)
-          result_path.push_back(coordinate);
       }
+      descending = not descending;
+    }
+  }
+
+  /// Reprojects walk() output in fixed-size chunks through the batch frame conversion.
+  template<typename F>
+  void Planner::produce(F&& f) const
+  {
+    constexpr const size_t CHUNK = 256;
+    double north[CHUNK], east[CHUNK], latitude[CHUNK], longitude[CHUNK];
+    const double altitude = (m_turn_around != 0) ? qQNaN() : m_frame.altitude();
+    size_t size = 0;
+
+    auto flush = [&]() {
+      m_frame.toGeo(size, north, east, nullptr, latitude, longitude, nullptr);
+      for(size_t i = 0; i < size; i++)
+        f(Waypoint{ latitude[i], longitude[i], altitude });
+      size = 0;
+    };
+
+    this->walk([&](double e, double n) {
+      north[size] = n;
+      east[size] = e;
+      if(++size == CHUNK)
+        flush();
+    });
+    flush();
+  }
+
+  size_t Planner::plan(Waypoint* out, size_t capacity) const noexcept
+  {
+    size_t ret = 0;
+    this->produce([&](const Waypoint& waypoint) {
+      if(ret < capacity)
+        out[ret++] = waypoint;
+    });
+    return ret;
+  }
+
+  void Planner::plan(vector<Waypoint>& out) const
+  {
+    out.resize(waypointCount());
+    out.resize(this->plan(out.data(), out.size()));
+  }
+
+  void Planner::plan(const std::function<void(const Waypoint&)>& sink) const { this->produce(sink); }
+
+  QGeoPath buildTraverse(const QGeoPolygon& poly, float angle, float spacing, float turn_around, Entry entry)
+  {
+    if(poly.isEmpty())
+      return {};
+
+    if(spacing < 0.5f)
+      throw std::invalid_argument("CCL.Traverse.build: spacing is too low (< 0.5)");
 
+    QGeoPath ret;
+
+    if(poly.size() < 3)
+    {
+      ret.addCoordinate(poly.path().front());
+      ret.addCoordinate(poly.path().back());
+    }
+    else
+    {
+      Planner planner(poly, angle, spacing, turn_around, entry);
+      QList<QGeoCoordinate> result_path;
+      result_path.reserve(static_cast<int>(planner.waypointCount()));
+      {
+        CCL_METRIC_SCOPE(TraverseReprojection);
+        planner.plan([&result_path](const Waypoint& waypoint) {
+          result_path.push_back(QGeoCoordinate(waypoint.latitude, waypoint.longitude, waypoint.altitude));
+        });
+      }
       ret.setPath(result_path);
     }
 
     return ret;
   }
-} // CCL::Traverse
\ No newline at end of file
+} // CCL::Traverse
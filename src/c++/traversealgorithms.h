@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <deque>
+#include <functional>
+#include <vector>
+#include "geomath.h"
 
 class QPointF;
 class QPolygonF;
@@ -17,6 +21,7 @@ class QGeoPolygon;
 class QGeoCoordinate;
 
 using std::deque;
+using std::vector;
 using CoordinateArray1D = deque<QGeoCoordinate>;
 using CoordinateArray2D = deque<CoordinateArray1D>;
 
@@ -32,6 +37,52 @@ namespace CCL::Traverse
     Last = BottomRight
   };
 
+  struct Waypoint
+  {
+    double latitude;
+    double longitude;
+    double altitude;
+  };
+
+  /**
+   * Lawnmower planner over a polygon with holes, concave outlines supported.
+   * Transects run along azimuth `angle` and are intersected with the polygon by a
+   * sweep over its edges sorted in the rotated frame, so each transect only visits
+   * edges spanning it. A transect crossing the polygon several times is split into
+   * one segment per inside interval. Intervals are computed once on construction,
+   * waypoints are produced on demand into a caller buffer or a callback.
+   */
+  class Planner
+  {
+    public:
+      Planner(const QGeoPolygon& poly, float angle, float spacing, float turn_around, Entry entry);
+
+      [[nodiscard]] size_t transectCount() const noexcept;
+      [[nodiscard]] size_t segmentCount() const noexcept;
+      [[nodiscard]] size_t waypointCount() const noexcept;
+      [[nodiscard]] double pathLength() const noexcept;
+
+      size_t plan(Waypoint* out, size_t capacity) const noexcept;
+      void plan(vector<Waypoint>& out) const;
+      void plan(const std::function<void(const Waypoint&)>& sink) const;
+
+    private:
+      template<typename F>
+      void walk(F&& f) const;
+      template<typename F>
+      void produce(F&& f) const;
+
+    private:
+      LocalTangentFrame m_frame;
+      double m_cos;
+      double m_sin;
+      double m_turn_around;
+      Entry m_entry;
+      vector<double> m_positions;
+      vector<size_t> m_offsets;
+      vector<double> m_spans;
+  };
+
   QGeoPath buildTraverse(const QGeoPolygon& poly, float angle, float spacing, float turn_around, Entry entry);
 
   namespace Internal
@@ -0,0 +1,110 @@
+/* ---------------------------------------------------------------------
+ * CCL - Carthography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "traversebatch.h"
+#include <utility>
+#include <QtCore/QFutureInterface>
+#include <QtConcurrent/QtConcurrentMap>
+
+#define in :
+
+namespace
+{
+  using namespace CCL::Traverse;
+
+  struct BuildJob
+  {
+    using result_type = QGeoPath;
+
+    QGeoPath operator()(const Job& job) const
+    {
+      return buildTraverse(job.polygon, job.angle, job.spacing, job.turn_around, job.entry);
+    }
+  };
+
+  struct EvaluateAngle
+  {
+    using result_type = SweepResult;
+
+    QGeoPolygon polygon;
+    float spacing;
+    float turn_around;
+    Entry entry;
+    Criterion criterion;
+
+    SweepResult operator()(float angle) const
+    {
+      Planner planner(polygon, angle, spacing, turn_around, entry);
+      SweepResult ret;
+      ret.angle = angle;
+      ret.transects = planner.transectCount();
+      ret.length = planner.pathLength();
+      if(ret.transects > 0)
+        ret.score = (criterion == Criterion::TransectCount) ? static_cast<double>(ret.transects) : ret.length;
+      return ret;
+    }
+  };
+
+  void keepBest(SweepResult& best, const SweepResult& candidate)
+  {
+    if(candidate.score < best.score)
+      best = candidate;
+  }
+
+  /// Finished future carrying the error. Thrown on a pool thread it would only surface as QUnhandledException.
+  template<typename T>
+  QFuture<T> failed(const char* message)
+  {
+    QFutureInterface<T> ret;
+    ret.reportStarted();
+    ret.reportException(BatchError(message));
+    ret.reportFinished();
+    return ret.future();
+  }
+} // namespace
+
+namespace CCL::Traverse
+{
+  BatchError::BatchError(std::string message)
+    : m_message(std::move(message))
+  {}
+
+  void BatchError::raise() const { throw *this; }
+  BatchError* BatchError::clone() const { return new BatchError(*this); }
+  const char* BatchError::what() const noexcept { return m_message.c_str(); }
+
+  QFuture<QGeoPath> buildTraverseAsync(const QList<Job>& jobs)
+  {
+    for(const Job& job in jobs)
+      if(not job.polygon.isEmpty() and job.spacing < 0.5f)
+        return failed<QGeoPath>("CCL.Traverse.buildAsync: spacing is too low (< 0.5)");
+    return QtConcurrent::mapped(jobs, BuildJob());
+  }
+
+  QFuture<SweepResult> sweepAngles(const QGeoPolygon& poly, const QList<float>& angles, float spacing, float turn_around,
+                                   Entry entry, Criterion criterion)
+  {
+    if(poly.size() < 3)
+      return failed<SweepResult>("CCL.Traverse.sweep: polygon must have at least 3 vertices");
+    if(spacing < 0.5f)
+      return failed<SweepResult>("CCL.Traverse.sweep: spacing is too low (< 0.5)");
+
+    return QtConcurrent::mappedReduced(angles, EvaluateAngle{ poly, spacing, turn_around, entry, criterion }, keepBest,
+                                       QtConcurrent::OrderedReduce);
+  }
+
+  QFuture<QGeoPath> BatchPlanner::submit(const QList<Job>& jobs)
+  {
+    this->cancel();
+    m_future = buildTraverseAsync(jobs);
+    return m_future;
+  }
+
+  void BatchPlanner::cancel() { m_future.cancel(); }
+
+  QFuture<QGeoPath> BatchPlanner::future() const { return m_future; }
+} // CCL::Traverse
@@ -0,0 +1,83 @@
+/* ---------------------------------------------------------------------
+ * CCL - Carthography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <QtCore/QException>
+#include <QtCore/QFuture>
+#include <QtCore/QList>
+#include <QtPositioning/QGeoPath>
+#include <QtPositioning/QGeoPolygon>
+#include "traversealgorithms.h"
+
+namespace CCL::Traverse
+{
+  struct Job
+  {
+    QGeoPolygon polygon;
+    float angle;
+    float spacing;
+    float turn_around;
+    Entry entry;
+  };
+
+  enum class Criterion
+  {
+    TransectCount,
+    PathLength
+  };
+
+  struct SweepResult
+  {
+    float angle = 0;
+    size_t transects = 0;
+    double length = 0;
+    double score = std::numeric_limits<double>::infinity();
+  };
+
+  /**
+   * Invalid input of an async call. It is checked on the calling thread and reported through
+   * the returned future, whose waitForFinished() and result accessors rethrow it.
+   */
+  class BatchError : public QException
+  {
+    public:
+      explicit BatchError(std::string message);
+
+      void raise() const override;
+      [[nodiscard]] BatchError* clone() const override;
+      [[nodiscard]] const char* what() const noexcept override;
+
+    private:
+      std::string m_message;
+  };
+
+  /// Runs buildTraverse for every job on the global thread pool. Results keep input order.
+  QFuture<QGeoPath> buildTraverseAsync(const QList<Job>& jobs);
+
+  /// Evaluates every angle in parallel and resolves to the best one by criterion, ties go to the earlier angle.
+  QFuture<SweepResult> sweepAngles(const QGeoPolygon& poly, const QList<float>& angles, float spacing, float turn_around,
+                                   Entry entry, Criterion criterion = Criterion::TransectCount);
+
+  /**
+   * Keeps at most one batch alive: submitting a new batch cancels the pending part
+   * of the previous one, so e.g. a slider drag does not pile up stale replans.
+   */
+  class BatchPlanner
+  {
+    public:
+      QFuture<QGeoPath> submit(const QList<Job>& jobs);
+      void cancel();
+      [[nodiscard]] QFuture<QGeoPath> future() const;
+
+    private:
+      QFuture<QGeoPath> m_future;
+  };
+} // CCL::Traverse
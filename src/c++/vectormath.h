@@ -0,0 +1,86 @@
+/* ---------------------------------------------------------------------
+ * CCL - Carthography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// Clones a batch loop for AVX2 next to the baseline build, picked at load time.
+#if defined(__x86_64__) and defined(__ELF__) and (not defined(__clang__) or __clang_major__ >= 14)
+#define CCL_SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define CCL_SIMD_CLONES
+#endif
+
+/**
+ * Vectorizable replacements for libm sin/cos and atan2 in batch loops. libm calls cannot
+ * be vectorized, so these are straight-line polynomial versions (fdlibm sin/cos, Cephes atan)
+ * where every branch is a select. Loops built on them are auto-vectorized: SSE2 everywhere
+ * on x86-64, plus an AVX2 clone under CCL_SIMD_CLONES. Results stay within a few ulp of libm.
+ * Translation units using them need -fno-math-errno and -fno-trapping-math, see CMakeLists.txt.
+ */
+namespace CCL::Vector
+{
+  constexpr const double ROUND = 0x1.8p52;
+  constexpr const double PIO2_1 = 1.57079632673412561417e+00;
+  constexpr const double PIO2_2 = 6.07710050630396597660e-11;
+  constexpr const double PIO2_3 = 2.02226624871116645580e-21;
+  constexpr const double MOREBITS = 6.123233995736765886130e-17;
+
+  /// Round to nearest for |x| < 2^51, vectorizes on plain SSE2 unlike std::nearbyint.
+  inline double roundNearest(double x) noexcept { return (x + ROUND) - ROUND; }
+
+  inline void sincos(double x, double& sin_x, double& cos_x) noexcept
+  {
+    double j = roundNearest(x * (2 / M_PI));
+    double r = ((x - j * PIO2_1) - j * PIO2_2) - j * PIO2_3;
+    double z = r * r;
+    double sin_r = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03
+                   + z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06
+                   + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+    double cos_r = 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03
+                   + z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07
+                   + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+
+    // Quadrant of x is j mod 4.
+    double quadrant = j - 4 * roundNearest((j - 1.5) * 0.25);
+    bool odd = quadrant == 1 or quadrant == 3;
+    double s = odd ? cos_r : sin_r;
+    double c = odd ? sin_r : cos_r;
+    sin_x = (quadrant >= 2) ? -s : s;
+    cos_x = (quadrant == 1 or quadrant == 2) ? -c : c;
+  }
+
+  inline double atan2(double y, double x) noexcept
+  {
+    double ax = std::abs(x);
+    double ay = std::abs(y);
+    double high = std::max(ax, ay);
+    double t = std::min(ax, ay) / std::max(high, std::numeric_limits<double>::min());
+
+    // Every arm is computed and then selected: a division under a condition blocks if-conversion.
+    bool reduce = t > 0.66;
+    double reduced = (t - 1) / (t + 1);
+    double u = reduce ? reduced : t;
+    double z = u * u;
+    double p = (((-8.750608600031904122785e-01 * z - 1.615753718733365076637e+01) * z - 7.500855792314704667340e+01) * z
+                - 1.228866684490136173410e+02) * z - 6.485021904942025371773e+01;
+    double q = ((((z + 2.485846490142306297962e+01) * z + 1.650270098316988542046e+02) * z + 4.328810604912902668951e+02) * z
+                + 4.853903996359136964868e+02) * z + 1.945506571482613964425e+02;
+    double ret = u + u * (z * p / q);
+    double shifted = ret + (M_PI / 4 + 0.5 * MOREBITS);
+    ret = reduce ? shifted : ret;
+
+    double complement = (M_PI / 2 - ret) + MOREBITS;
+    ret = (ay > ax) ? complement : ret;
+    double supplement = (M_PI - ret) + 2 * MOREBITS;
+    ret = (x < 0) ? supplement : ret;
+    return std::copysign(ret, y);
+  }
+} // CCL::Vector
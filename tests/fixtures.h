@@ -0,0 +1,79 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <vector>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QList>
+#include <QtCore/QTimer>
+#include <QtCore/QVariant>
+#include <QtPositioning/QGeoCoordinate>
+#include <QtPositioning/QGeoPolygon>
+#include "CCL/TileCoverage"
+#include "CCL/TileStorage"
+
+/// Synthetic inputs and event loop helpers shared by test_ccl and bench_ccl.
+namespace CCL::Testing
+{
+  /// Convex polygon with `vertices` corners evenly spread on a circle of `radius` meters.
+  inline QGeoPolygon regularPolygon(const QGeoCoordinate& center, double radius, int vertices)
+  {
+    QGeoPolygon ret;
+    for(int i = 0; i < vertices; i++)
+      ret.addCoordinate(center.atDistanceAndAzimuth(radius, 360.0 * i / vertices));
+    return ret;
+  }
+
+  /// Concave polygon alternating between `radius` and `radius * ratio` every other corner.
+  inline QGeoPolygon starPolygon(const QGeoCoordinate& center, double radius, int vertices, double ratio = 0.5)
+  {
+    QGeoPolygon ret;
+    for(int i = 0; i < vertices; i++)
+      ret.addCoordinate(center.atDistanceAndAzimuth(i % 2 ? radius * ratio : radius, 360.0 * i / vertices));
+    return ret;
+  }
+
+  inline QList<QVariant> toVariantList(const QGeoPolygon& polygon)
+  {
+    QList<QVariant> ret;
+    for(const QGeoCoordinate& point : polygon.path())
+      ret.push_back(QVariant::fromValue(point));
+    return ret;
+  }
+
+  /// Every tile of the polygon's coverage in cursor order.
+  inline std::vector<TileKey> coveredTiles(const QGeoPolygon& polygon, int min_zoom, int max_zoom)
+  {
+    std::vector<TileKey> ret;
+    TileCoverage::Cursor cursor = TileCoverage(polygon).cursor(min_zoom, max_zoom);
+    int zoom, x, y;
+    while(cursor.next(zoom, x, y))
+      ret.push_back(packTileKey(zoom, x, y));
+    return ret;
+  }
+
+  /// Spins the event loop until predicate holds. Returns false on timeout (ms).
+  inline bool waitFor(const std::function<bool()>& predicate, int timeout = 10'000)
+  {
+    QElapsedTimer clock;
+    clock.start();
+    while(not predicate())
+    {
+      if(clock.hasExpired(timeout))
+        return false;
+
+      QEventLoop loop;
+      QTimer::singleShot(5, &loop, &QEventLoop::quit);
+      loop.exec();
+    }
+    return true;
+  }
+} // CCL::Testing
@@ -0,0 +1,202 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <QtCore/QPointF>
+#include <QtPositioning/QGeoCoordinate>
+#include "CCL/Geomath"
+#include "CCL/TileLoader"
+
+#define in :
+
+using namespace CCL;
+using std::vector;
+
+namespace
+{
+  const QGeoCoordinate ORIGINS[] = { { 0, 0, 0 }, { 55.7558, 37.6173, 150 }, { -33.86, 151.21, 20 },
+                                     { 78.22, 15.65, 0 }, { 10, 179.95, 0 }, { -60, -179.95, 0 } };
+
+  constexpr const double RADIUS = 6'371'000.0;
+  constexpr const double RAD = M_PI / 180.0;
+
+  /// Azimuthal equidistant projection written straight from the textbook with libm, the batch reference.
+  void referenceNED(const QGeoCoordinate& origin, double latitude, double longitude, double& north, double& east)
+  {
+    double phi0 = origin.latitude() * RAD, phi = latitude * RAD, d_lambda = (longitude - origin.longitude()) * RAD;
+    double cos_c = std::sin(phi0) * std::sin(phi) + std::cos(phi0) * std::cos(phi) * std::cos(d_lambda);
+    double n = std::cos(phi0) * std::sin(phi) - std::sin(phi0) * std::cos(phi) * std::cos(d_lambda);
+    double e = std::cos(phi) * std::sin(d_lambda);
+    double sin_c = std::hypot(n, e);
+    double k = sin_c > 0 ? std::atan2(sin_c, cos_c) / sin_c : 1.0;
+    north = k * n * RADIUS;
+    east = k * e * RADIUS;
+  }
+
+  /// Points up to `range` meters around origin plus the origin itself, fixed seed.
+  vector<QGeoCoordinate> scatter(const QGeoCoordinate& origin, double range, size_t count)
+  {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> distance(0, range);
+    std::uniform_real_distribution<double> azimuth(0, 360);
+    vector<QGeoCoordinate> ret = { origin };
+    for(size_t i = 0; i < count; i++)
+      ret.push_back(origin.atDistanceAndAzimuth(distance(random), azimuth(random)));
+    return ret;
+  }
+} // namespace
+
+TEST(Geomath, NEDOfOriginIsZero)
+{
+  for(const QGeoCoordinate& origin in ORIGINS)
+  {
+    NEDPoint ned = geo2NED(origin, origin);
+    EXPECT_EQ(ned.x, 0);
+    EXPECT_EQ(ned.y, 0);
+    EXPECT_EQ(ned.z, 0);
+  }
+}
+
+TEST(Geomath, NEDAxesFollowNorthEastDown)
+{
+  const double arc = 0.01 * M_PI / 180.0 * 6'371'000.0;
+  QGeoCoordinate origin(0, 0, 100);
+
+  NEDPoint north = geo2NED(QGeoCoordinate(0.01, 0, 100), origin);
+  EXPECT_NEAR(north.x, arc, 1e-3);
+  EXPECT_NEAR(north.y, 0, 1e-3);
+
+  NEDPoint east = geo2NED(QGeoCoordinate(0, 0.01, 100), origin);
+  EXPECT_NEAR(east.x, 0, 1e-3);
+  EXPECT_NEAR(east.y, arc, 1e-3);
+
+  NEDPoint up = geo2NED(QGeoCoordinate(0, 0.01, 130), origin);
+  EXPECT_FLOAT_EQ(up.z, -30);
+}
+
+TEST(Geomath, NEDRoundTrip)
+{
+  for(const QGeoCoordinate& origin in ORIGINS)
+  {
+    for(double distance in { 1.0, 250.0, 5'000.0, 40'000.0 })
+    {
+      for(double azimuth = 0; azimuth < 360; azimuth += 45)
+      {
+        QGeoCoordinate point = origin.atDistanceAndAzimuth(distance, azimuth);
+        point.setAltitude(origin.altitude() + 12.5);
+        QGeoCoordinate back = ned2geo(geo2NED(point, origin), origin);
+
+        EXPECT_NEAR(back.latitude(), point.latitude(), 1e-6) << distance << " m at " << azimuth;
+        EXPECT_NEAR(std::remainder(back.longitude() - point.longitude(), 360.0), 0, 1e-6) << distance << " m at " << azimuth;
+        EXPECT_NEAR(back.altitude(), point.altitude(), 1e-3);
+      }
+    }
+  }
+}
+
+TEST(Geomath, WebMercatorKnownPoints)
+{
+  QPointF center = geo2webmercator(QGeoCoordinate(0, 0), 1);
+  EXPECT_DOUBLE_EQ(center.x(), 1.0);
+  EXPECT_DOUBLE_EQ(center.y(), 1.0);
+
+  QPointF corner = geo2webmercator(QGeoCoordinate(85.0511287798, -180), 0);
+  EXPECT_NEAR(corner.x(), 0.0, 1e-9);
+  EXPECT_DOUBLE_EQ(corner.y(), 0.0);
+}
+
+// geo2webmercator returns (row, column) in tile units, its integer part must agree with TileLoader.
+TEST(Geomath, WebMercatorAgreesWithTileMath)
+{
+  for(const QGeoCoordinate& origin in ORIGINS)
+  {
+    for(uint8_t zoom in { 0, 5, 12, 19 })
+    {
+      QPointF tile = geo2webmercator(origin, zoom);
+      EXPECT_EQ(static_cast<uint32_t>(tile.x()), TileLoader::latitudeToTileY(origin.latitude(), zoom));
+      EXPECT_EQ(static_cast<uint32_t>(tile.y()), TileLoader::longitudeToTileX(origin.longitude(), zoom));
+    }
+  }
+}
+
+// Batch kernels use their own polynomial sin/cos/atan2: they must match libm to well below a millimeter,
+// including odd remainders (count not a multiple of the vector width) and far points in every quadrant.
+TEST(GeomathBatch, ToNEDMatchesReference)
+{
+  for(const QGeoCoordinate& origin in ORIGINS)
+  {
+    for(double range in { 100.0, 50'000.0, 5'000'000.0 })
+    {
+      vector<QGeoCoordinate> points = scatter(origin, range, 1'001);
+      vector<double> latitude, longitude, altitude, north(points.size()), east(points.size()), down(points.size());
+      for(const QGeoCoordinate& point in points)
+      {
+        latitude.push_back(point.latitude());
+        longitude.push_back(point.longitude());
+        altitude.push_back(origin.altitude() + 7);
+      }
+
+      LocalTangentFrame frame(origin);
+      frame.toNED(points.size(), latitude.data(), longitude.data(), altitude.data(), north.data(), east.data(), down.data());
+      for(size_t i = 0; i < points.size(); i++)
+      {
+        double ref_north, ref_east;
+        referenceNED(origin, latitude[i], longitude[i], ref_north, ref_east);
+        ASSERT_NEAR(north[i], ref_north, 1e-6) << origin.latitude() << ", " << origin.longitude() << " #" << i;
+        ASSERT_NEAR(east[i], ref_east, 1e-6) << origin.latitude() << ", " << origin.longitude() << " #" << i;
+        ASSERT_DOUBLE_EQ(down[i], -7);
+
+        // Scalar API rounds to float, agree up to that rounding.
+        NEDPoint scalar = frame.toNED(points[i]);
+        const double ulp = std::max(1.0, std::hypot(ref_north, ref_east)) * 1.2e-7;
+        ASSERT_NEAR(scalar.x, north[i], ulp);
+        ASSERT_NEAR(scalar.y, east[i], ulp);
+      }
+    }
+  }
+}
+
+TEST(GeomathBatch, ToGeoInvertsToNED)
+{
+  for(const QGeoCoordinate& origin in ORIGINS)
+  {
+    for(double range in { 100.0, 50'000.0, 5'000'000.0 })
+    {
+      vector<QGeoCoordinate> points = scatter(origin, range, 1'003);
+      const size_t count = points.size();
+      vector<double> latitude, longitude, north(count), east(count), back_latitude(count), back_longitude(count), altitude(count);
+      for(const QGeoCoordinate& point in points)
+      {
+        latitude.push_back(point.latitude());
+        longitude.push_back(point.longitude());
+      }
+
+      LocalTangentFrame frame(origin);
+      frame.toNED(count, latitude.data(), longitude.data(), nullptr, north.data(), east.data(), nullptr);
+      frame.toGeo(count, north.data(), east.data(), nullptr, back_latitude.data(), back_longitude.data(), altitude.data());
+      for(size_t i = 0; i < count; i++)
+      {
+        ASSERT_NEAR(back_latitude[i], latitude[i], 1e-10) << origin.latitude() << ", " << origin.longitude() << " #" << i;
+        ASSERT_NEAR(std::remainder(back_longitude[i] - longitude[i], 360.0), 0, 1e-10 / std::max(1e-3, std::cos(latitude[i] * RAD)));
+        ASSERT_GE(back_longitude[i], -180);
+        ASSERT_LE(back_longitude[i], 180);
+        ASSERT_EQ(altitude[i], origin.altitude());
+
+        // Scalar inverse of the same (float rounded) offsets.
+        QGeoCoordinate scalar = frame.toGeo(NEDPoint(static_cast<float>(north[i]), static_cast<float>(east[i]), 0));
+        double batch_latitude, batch_longitude, ned_north = static_cast<float>(north[i]), ned_east = static_cast<float>(east[i]);
+        frame.toGeo(1, &ned_north, &ned_east, nullptr, &batch_latitude, &batch_longitude, nullptr);
+        ASSERT_NEAR(scalar.latitude(), batch_latitude, 1e-10);
+        ASSERT_NEAR(std::remainder(scalar.longitude() - batch_longitude, 360.0), 0, 1e-10 / std::max(1e-3, std::cos(batch_latitude * RAD)));
+      }
+    }
+  }
+}
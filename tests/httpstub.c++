@@ -0,0 +1,103 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include "httpstub.h"
+#include <stdexcept>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QTcpSocket>
+
+namespace CCL::Testing
+{
+  HttpStub::HttpStub(QByteArray payload, QObject* parent)
+    : QObject(parent)
+    , m_payload(std::move(payload))
+    , m_total(0)
+  {
+    connect(&m_server, &QTcpServer::newConnection, this, &HttpStub::onConnection);
+    if(not m_server.listen(QHostAddress::LocalHost))
+      throw std::runtime_error("CCL.Testing.HttpStub: failed to listen: " + m_server.errorString().toStdString());
+  }
+
+  QString HttpStub::urlTemplate() const { return QString("http://127.0.0.1:%1").arg(m_server.serverPort()) + "/%1/%2/%3"; }
+  QByteArray HttpStub::payload() const { return m_payload; }
+
+  int HttpStub::requests() const { return m_total; }
+  int HttpStub::requests(int zoom, int x, int y) const { return m_requests.value(pathOf(zoom, x, y)); }
+
+  void HttpStub::fail(int zoom, int x, int y, int status, int times)
+  {
+    if(times != 0)
+      m_scripts.insert(pathOf(zoom, x, y), { status, times });
+  }
+
+  void HttpStub::stall(int zoom, int x, int y, int times) { this->fail(zoom, x, y, 0, times); }
+
+  void HttpStub::onConnection()
+  {
+    while(QTcpSocket* socket = m_server.nextPendingConnection())
+    {
+      connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { this->onReadyRead(socket); });
+      connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+        m_buffers.remove(socket);
+        socket->deleteLater();
+      });
+    }
+  }
+
+  void HttpStub::onReadyRead(QTcpSocket* socket)
+  {
+    QByteArray& buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    // GET requests carry no body, every blank line ends one request.
+    int end;
+    while((end = buffer.indexOf("\r\n\r\n")) >= 0)
+    {
+      QByteArray head = buffer.left(end);
+      buffer.remove(0, end + 4);
+
+      QList<QByteArray> request_line = head.left(head.indexOf("\r\n")).split(' ');
+      if(request_line.size() < 2)
+      {
+        socket->disconnectFromHost();
+        return;
+      }
+      this->respond(socket, request_line[1]);
+    }
+  }
+
+  void HttpStub::respond(QTcpSocket* socket, const QByteArray& path)
+  {
+    m_total++;
+    m_requests[path]++;
+
+    int status = 200;
+    auto script = m_scripts.find(path);
+    if(script != m_scripts.end())
+    {
+      status = script->status;
+      if(script->times > 0 and --script->times == 0)
+        m_scripts.erase(script);
+    }
+
+    // Stalled: the connection stays open and silent until the client gives up.
+    if(status == 0)
+      return;
+
+    QByteArray body = (status == 200) ? m_payload : QByteArray();
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + (status == 200 ? " OK" : " Error") + "\r\n"
+                      "Content-Type: image/png\r\n"
+                      "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                      "Connection: keep-alive\r\n\r\n";
+    socket->write(head + body);
+  }
+
+  QByteArray HttpStub::pathOf(int zoom, int x, int y)
+  {
+    return "/" + QByteArray::number(zoom) + "/" + QByteArray::number(x) + "/" + QByteArray::number(y);
+  }
+} // CCL::Testing
@@ -0,0 +1,66 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtNetwork/QTcpServer>
+
+class QTcpSocket;
+
+namespace CCL::Testing
+{
+  /**
+   * Local HTTP/1.1 tile server used as the download pipeline fixture.
+   * Answers every GET /z/x/y on 127.0.0.1 with the same payload over keep-alive
+   * connections. Single paths can be scripted to answer with an error status, or to
+   * stall (accept the request and never reply), for their next N requests.
+   */
+  class HttpStub : public QObject
+  {
+    Q_OBJECT
+
+    public:
+      explicit HttpStub(QByteArray payload = QByteArray(1'024, 'x'), QObject* parent = nullptr);
+
+      /// Server URL in the TileLoader::serverUrl format, with %1/%2/%3 for z/x/y.
+      [[nodiscard]] QString urlTemplate() const;
+      [[nodiscard]] QByteArray payload() const;
+
+      [[nodiscard]] int requests() const;
+      [[nodiscard]] int requests(int zoom, int x, int y) const;
+
+      /// Next `times` requests of the tile get `status` with an empty body, times < 0 means always.
+      void fail(int zoom, int x, int y, int status, int times = -1);
+      /// Next `times` requests of the tile are never answered, times < 0 means always.
+      void stall(int zoom, int x, int y, int times = -1);
+
+    private:
+      struct Script
+      {
+        int status;   ///< 0 stalls
+        int times;
+      };
+
+      void onConnection();
+      void onReadyRead(QTcpSocket* socket);
+      void respond(QTcpSocket* socket, const QByteArray& path);
+
+      static QByteArray pathOf(int zoom, int x, int y);
+
+    private:
+      QTcpServer m_server;
+      QByteArray m_payload;
+      QHash<QByteArray, Script> m_scripts;
+      QHash<QByteArray, int> m_requests;
+      QHash<QTcpSocket*, QByteArray> m_buffers;
+      int m_total;
+  };
+} // CCL::Testing
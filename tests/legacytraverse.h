@@ -0,0 +1,127 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <QtCore/QLineF>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtGui/QPolygonF>
+#include <QtPositioning/QGeoPath>
+#include <QtPositioning/QGeoPolygon>
+#include "CCL/Geomath"
+#include "CCL/Traverse"
+
+namespace CCL::Testing
+{
+  /**
+   * buildTraverse as it was before Traverse::Planner, kept as the reference for
+   * test_ccl and bench_ccl. Carries the three fixes Planner made, nothing else:
+   * the polygon is projected east/north like it is reprojected (it was clipped
+   * mirrored across the diagonal), the transect loop is bounded by the far edge
+   * of the bounding square, and the single-line fallback keeps the line it
+   * centers instead of reading a cleared deque.
+   */
+  inline QGeoPath legacyBuildTraverse(const QGeoPolygon& poly, float angle, float spacing, float turn_around,
+                                      Traverse::Entry entry)
+  {
+    using namespace CCL::Traverse;
+
+    if(poly.isEmpty())
+      return {};
+
+    QGeoPath ret;
+    if(poly.size() < 3)
+    {
+      ret.addCoordinate(poly.path().front());
+      ret.addCoordinate(poly.path().back());
+      return ret;
+    }
+
+    std::deque<QPointF> poly_points;
+    QGeoCoordinate tg_origin = poly.path().front();
+
+    bool lf = false;
+    for(const QGeoCoordinate& point : poly.path())
+    {
+      NEDPoint ned;
+      if(lf)
+        ned = geo2NED(point, tg_origin);
+      else
+        lf = true;
+      poly_points.emplace_back(ned.y, ned.x);
+    }
+
+    float grid_angle = Internal::clampTraverseGridAngle(angle);
+    QPolygonF polygon;
+    for(const QPointF& point : poly_points)
+      polygon << point;
+    polygon << poly_points.front();
+
+    QRectF bounding_rect = polygon.boundingRect();
+    std::deque<QLineF> lines;
+    float max_w = static_cast<float>(std::max(bounding_rect.width(), bounding_rect.height()) + 2000.0f);
+    float transect_x = static_cast<float>(bounding_rect.center().x() - max_w / 2);
+    const float transect_end = transect_x + max_w;
+    while(transect_x < transect_end)
+    {
+      lines.emplace_back(Internal::rotateTraversePoint({transect_x, bounding_rect.center().y() - max_w / 2}, bounding_rect.center(), grid_angle),
+                         Internal::rotateTraversePoint({transect_x, bounding_rect.center().y() + max_w / 2}, bounding_rect.center(), grid_angle));
+      transect_x += spacing;
+    }
+
+    std::deque<QLineF> intersection_lines = Internal::findIntersectionWithPolygon(lines, polygon);
+    if(intersection_lines.size() < 2)
+    {
+      QLineF front = lines.front();
+      lines.clear();
+      lines.push_back(front.translated(bounding_rect.center() - front.pointAt(0.5)));
+      intersection_lines = Internal::findIntersectionWithPolygon(lines, polygon);
+    }
+
+    std::deque<QLineF> result = Internal::adjustLineDirections(intersection_lines);
+    CoordinateArray2D transects;
+    for(const QLineF& line : result)
+    {
+      std::deque<QGeoCoordinate> transect;
+      transect.emplace_back(ned2geo({static_cast<float>(line.p1().y()), static_cast<float>(line.p1().x()), 0}, tg_origin));
+      transect.emplace_back(ned2geo({static_cast<float>(line.p2().y()), static_cast<float>(line.p2().x()), 0}, tg_origin));
+      transects.push_back(transect);
+    }
+
+    Internal::adjustTransects(transects, entry);
+    bool rv = false;
+    for(CoordinateArray1D& transect : transects)
+    {
+      if(rv)
+        std::reverse(transect.begin(), transect.end());
+      rv = not rv;
+    }
+
+    QList<QGeoCoordinate> result_path;
+    for(CoordinateArray1D& transect : transects)
+    {
+      double tad = turn_around;
+      if(tad != 0)
+      {
+        double azimuth = transect.front().azimuthTo(transect[1]);
+        transect.front() = transect.front().atDistanceAndAzimuth(-tad, azimuth);
+        transect.front().setAltitude(qQNaN());
+        transect[1] = transect[1].atDistanceAndAzimuth(tad, azimuth);
+        transect[1].setAltitude(qQNaN());
+      }
+
+      for(const QGeoCoordinate& coordinate : transect)
+        result_path.push_back(coordinate);
+    }
+
+    ret.setPath(result_path);
+    return ret;
+  }
+} // CCL::Testing
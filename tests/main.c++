@@ -0,0 +1,17 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <gtest/gtest.h>
+#include <QtCore/QCoreApplication>
+
+// TileLoader and the HTTP stub need a running application object for their event loop.
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  QCoreApplication app(argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <QtCore/QVariantMap>
+#include "CCL/Metrics"
+
+#define in :
+
+using namespace CCL;
+
+namespace
+{
+  QVariantMap histogramOf(const char* name)
+  {
+    return Metrics::snapshot().value("histograms").toMap().value(name).toMap();
+  }
+} // namespace
+
+// Runs in test_ccl with whatever CCL_METRICS_ENABLED the library was configured with, and in
+// test_ccl_metrics with metrics forced on, so both sides of the switch are exercised.
+TEST(Metrics, MacroArgumentsOnlyEvaluatedWhenEnabled)
+{
+  Metrics::reset();
+  int evaluated = 0;
+  [[maybe_unused]] auto touch = [&evaluated]() { return ++evaluated; };
+  CCL_METRIC_ADD(TileRequests, touch());
+  CCL_METRIC_SET(TileQueueDepth, touch());
+  CCL_METRIC_RECORD(TileLatency, touch());
+  {
+    CCL_METRIC_SCOPE(DiskWrite);
+  }
+
+  QVariantMap snapshot = Metrics::snapshot();
+  EXPECT_EQ(snapshot.value("enabled").toBool(), Metrics::enabled());
+  EXPECT_EQ(MetricsProvider::enabled(), Metrics::enabled());
+  if(Metrics::enabled())
+  {
+    EXPECT_EQ(evaluated, 3);
+    EXPECT_EQ(snapshot.value("counters").toMap().value("tileRequests").toULongLong(), 1u);
+    EXPECT_EQ(histogramOf("diskWrite").value("count").toULongLong(), 1u);
+  }
+  else
+  {
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_EQ(snapshot.keys(), QStringList { "enabled" });
+  }
+}
+
+TEST(Metrics, SnapshotNamesEveryMetric)
+{
+  if(not Metrics::enabled())
+    GTEST_SKIP() << "built without CCL_METRICS_ENABLED";
+
+  QVariantMap snapshot = Metrics::snapshot();
+  EXPECT_EQ(snapshot.value("counters").toMap().size(), static_cast<int>(Metrics::Counter::Count));
+  EXPECT_EQ(snapshot.value("gauges").toMap().size(), static_cast<int>(Metrics::Gauge::Count));
+  EXPECT_EQ(snapshot.value("histograms").toMap().size(), static_cast<int>(Metrics::Histogram::Count));
+  for(const char* name in { "tileFailures", "tileRetries", "tileCancellations" })
+    EXPECT_TRUE(snapshot.value("counters").toMap().contains(name)) << name;
+}
+
+// Quantiles report the upper bound of their power-of-two bucket, never more than the largest value.
+TEST(Metrics, HistogramQuantiles)
+{
+  if(not Metrics::enabled())
+    GTEST_SKIP() << "built without CCL_METRICS_ENABLED";
+
+  Metrics::reset();
+  for(int i = 0; i < 90; i++)
+    Metrics::record(Metrics::Histogram::TileLatency, 10);
+  for(int i = 0; i < 9; i++)
+    Metrics::record(Metrics::Histogram::TileLatency, 1'000);
+  Metrics::record(Metrics::Histogram::TileLatency, 100'000);
+
+  QVariantMap latency = histogramOf("tileLatency");
+  EXPECT_EQ(latency.value("count").toULongLong(), 100u);
+  EXPECT_EQ(latency.value("sum").toULongLong(), 109'900u);
+  EXPECT_DOUBLE_EQ(latency.value("mean").toDouble(), 1'099);
+  EXPECT_EQ(latency.value("max").toULongLong(), 100'000u);
+  EXPECT_EQ(latency.value("p50").toULongLong(), 15u);
+  EXPECT_EQ(latency.value("p90").toULongLong(), 1'023u);
+  EXPECT_EQ(latency.value("p99").toULongLong(), 100'000u);
+}
+
+TEST(Metrics, HistogramEdgeBuckets)
+{
+  if(not Metrics::enabled())
+    GTEST_SKIP() << "built without CCL_METRICS_ENABLED";
+
+  Metrics::reset();
+  QVariantMap empty = histogramOf("diskWrite");
+  EXPECT_EQ(empty.value("count").toULongLong(), 0u);
+  EXPECT_EQ(empty.value("p50").toULongLong(), 0u);
+  EXPECT_EQ(empty.value("mean").toDouble(), 0.0);
+
+  // Zero and one share the first bucket, values past the last bound land in the open last one.
+  Metrics::record(Metrics::Histogram::DiskWrite, 0);
+  Metrics::record(Metrics::Histogram::DiskWrite, 1);
+  EXPECT_EQ(histogramOf("diskWrite").value("p99").toULongLong(), 1u);
+
+  const uint64_t huge = uint64_t(1) << 40;
+  Metrics::record(Metrics::Histogram::DiskWrite, huge);
+  QVariantMap stats = histogramOf("diskWrite");
+  EXPECT_EQ(stats.value("p50").toULongLong(), 1u);
+  EXPECT_EQ(stats.value("p90").toULongLong(), huge);
+  EXPECT_EQ(stats.value("max").toULongLong(), huge);
+
+  Metrics::reset();
+  EXPECT_EQ(histogramOf("diskWrite").value("count").toULongLong(), 0u);
+}
+
+TEST(Metrics, ResetKeepsGaugeLevels)
+{
+  if(not Metrics::enabled())
+    GTEST_SKIP() << "built without CCL_METRICS_ENABLED";
+
+  Metrics::set(Metrics::Gauge::TilesInFlight, 5);
+  Metrics::add(Metrics::Counter::TileRequests, 3);
+  Metrics::reset();
+
+  QVariantMap snapshot = Metrics::snapshot();
+  EXPECT_EQ(snapshot.value("gauges").toMap().value("tilesInFlight").toLongLong(), 5);
+  EXPECT_EQ(snapshot.value("counters").toMap().value("tileRequests").toULongLong(), 0u);
+  Metrics::set(Metrics::Gauge::TilesInFlight, 0);
+}
@@ -0,0 +1,178 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include <QtPositioning/QGeoCoordinate>
+#include "CCL/GreatCircleModel"
+#include "CCL/Orthodrom"
+
+#define in :
+
+using namespace CCL;
+
+namespace
+{
+  QGeoCoordinate at(const QList<QVariant>& path, int index) { return path.at(index).value<QGeoCoordinate>(); }
+} // namespace
+
+TEST(Orthodrom, DefaultHoldsTwoPoints)
+{
+  EXPECT_EQ(Orthodrom().get().size(), 2);
+}
+
+// The historical path runs from the second coordinate back to the first, one point per 10 km at most.
+TEST(Orthodrom, PathRunsFromSecondToFirst)
+{
+  QGeoCoordinate first(55.75, 37.61);
+  QGeoCoordinate second(59.94, 30.31);
+  QList<QVariant> path = Orthodrom(first, second).get();
+
+  ASSERT_GE(path.size(), 2);
+  EXPECT_LT(at(path, 0).distanceTo(second), 1e-3);
+  EXPECT_LT(at(path, path.size() - 1).distanceTo(first), 1e-3);
+
+  double length = first.distanceTo(second);
+  EXPECT_EQ(path.size(), static_cast<int>(std::ceil(length / 10'000)) + 1);
+  for(int i = 1; i < path.size(); i++)
+    EXPECT_LE(at(path, i - 1).distanceTo(at(path, i)), 10'000 * 1.001);
+}
+
+TEST(Orthodrom, EquatorStaysOnEquator)
+{
+  QList<QVariant> path = Orthodrom({ 0, 0 }, { 0, 90 }).get();
+  ASSERT_GT(path.size(), 2);
+  for(int i = 0; i < path.size(); i++)
+    EXPECT_NEAR(at(path, i).latitude(), 0, 1e-9);
+}
+
+TEST(Orthodrom, LatitudeAtEndpoints)
+{
+  QGeoCoordinate first(40.64, -73.78);
+  QGeoCoordinate second(51.47, -0.45);
+  Orthodrom orthodrom(first, second);
+
+  EXPECT_NEAR(orthodrom.latitudeAt(first.longitude()), first.latitude(), 1e-9);
+  EXPECT_NEAR(orthodrom.latitudeAt(second.longitude()), second.latitude(), 1e-9);
+
+  // Great circle vertex lies poleward of both endpoints on a transatlantic leg.
+  EXPECT_GT(orthodrom.latitudeAt(-40), second.latitude());
+}
+
+TEST(GreatCircle, SampleMatchesScalarPoints)
+{
+  GreatCircle arc({ 40.64, -73.78 }, { 35.55, 139.78 });
+  const size_t count = arc.countForSpacing(5'000);
+  std::vector<QGeoCoordinate> points;
+  arc.sample(count, points);
+
+  ASSERT_EQ(points.size(), count);
+  for(size_t i = 0; i < count; i++)
+    EXPECT_LT(points[i].distanceTo(arc.at(static_cast<double>(i) / static_cast<double>(count - 1))), 1e-3) << i;
+}
+
+// Longitudes wrap from +180 to -180 between two neighbours that are still one spacing apart.
+TEST(GreatCircle, AntimeridianCrossingIsContinuous)
+{
+  QGeoCoordinate first(-10, 170);
+  QGeoCoordinate second(10, -170);
+  GreatCircle arc(first, second);
+  std::vector<QGeoCoordinate> points;
+  arc.sample(arc.countForSpacing(10'000), points);
+
+  ASSERT_GT(points.size(), 2u);
+  const double spacing = arc.length() / static_cast<double>(points.size() - 1);
+  int wraps = 0;
+  for(size_t i = 0; i < points.size(); i++)
+  {
+    EXPECT_GE(std::abs(points[i].longitude()), 170 - 1e-9) << i;
+    if(i == 0)
+      continue;
+    EXPECT_NEAR(points[i - 1].distanceTo(points[i]), spacing, 1) << i;
+    if(points[i - 1].longitude() > 0 and points[i].longitude() < 0)
+      wraps++;
+  }
+  EXPECT_EQ(wraps, 1);
+  EXPECT_NEAR(arc.length(), first.distanceTo(second), 0.01 * arc.length());
+}
+
+// Over the pole the longitude flips by 180 degrees, the latitude peaks at 90 and comes back down.
+TEST(GreatCircle, PolarCrossingIsContinuous)
+{
+  GreatCircle arc({ 80, 30 }, { 80, -150 });
+  std::vector<QGeoCoordinate> points;
+  arc.sample(101, points);
+
+  const double spacing = arc.length() / 100;
+  EXPECT_NEAR(points[50].latitude(), 90, 1e-6);
+  for(size_t i = 1; i < points.size(); i++)
+  {
+    EXPECT_NEAR(points[i - 1].distanceTo(points[i]), spacing, 1) << i;
+    if(i < 50)
+    {
+      EXPECT_GT(points[i].latitude(), points[i - 1].latitude()) << i;
+      EXPECT_NEAR(points[i].longitude(), 30, 1e-6) << i;
+    }
+    else if(i > 50)
+    {
+      EXPECT_LT(points[i].latitude(), points[i - 1].latitude()) << i;
+      EXPECT_NEAR(points[i].longitude(), -150, 1e-6) << i;
+    }
+  }
+}
+
+// Antipodal endpoints take the meridian of the first point, northwards.
+TEST(GreatCircle, AntipodalFollowsFirstMeridian)
+{
+  GreatCircle arc({ 0, 20 }, { 0, -160 });
+  EXPECT_NEAR(arc.angle(), M_PI, 1e-12);
+  EXPECT_NEAR(arc.at(0.25).latitude(), 45, 1e-9);
+  EXPECT_NEAR(arc.at(0.25).longitude(), 20, 1e-9);
+  EXPECT_NEAR(arc.at(0.5).latitude(), 90, 1e-9);
+}
+
+TEST(GreatCircle, ErrorCountsAgreeAcrossUnits)
+{
+  GreatCircle arc({ 40.64, -73.78 }, { 35.55, 139.78 });
+  for(double meters in { 1.0, 100.0, 10'000.0 })
+    EXPECT_EQ(arc.countForAngularError(meters / 6'371'000.0), arc.countForError(meters)) << meters;
+
+  // Sagitta of every step stays within the bound.
+  const double radians = 1e-5;
+  const size_t count = arc.countForAngularError(radians);
+  EXPECT_LE(1 - std::cos(arc.angle() / static_cast<double>(count - 1) / 2), radians);
+  EXPECT_GT(1 - std::cos(arc.angle() / static_cast<double>(count - 2) / 2), radians);
+}
+
+// Count and length are notified apart, and only when they change.
+TEST(GreatCircleModel, NotifiesOnlyOnChange)
+{
+  GreatCircleModel model;
+  int counts = 0, lengths = 0;
+  QObject::connect(&model, &GreatCircleModel::countChanged, [&counts]() { counts++; });
+  QObject::connect(&model, &GreatCircleModel::lengthChanged, [&lengths]() { lengths++; });
+
+  model.setFirst({ 55.75, 37.61 });
+  EXPECT_EQ(counts, 0);
+  EXPECT_EQ(lengths, 0);
+
+  model.setSecond({ 59.94, 30.31 });
+  EXPECT_EQ(counts, 1);
+  EXPECT_EQ(lengths, 1);
+
+  model.setSpacing(model.spacing() / 2);
+  EXPECT_EQ(counts, 2);
+  EXPECT_EQ(lengths, 1);
+
+  // A kilometre of chord error needs far fewer points than the spacing already gives.
+  const int count = model.count();
+  model.setMaxError(1'000);
+  EXPECT_EQ(model.count(), count);
+  EXPECT_EQ(counts, 2);
+  EXPECT_EQ(lengths, 1);
+}
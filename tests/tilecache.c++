@@ -0,0 +1,123 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <gtest/gtest.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QTemporaryDir>
+#include "CCL/TileCache"
+#include "CCL/TileLoader"
+#include "fixtures.h"
+
+#define in :
+
+using namespace CCL;
+using namespace CCL::Testing;
+
+TEST(TileCache, MissingTileIsDistinctFromCacheMiss)
+{
+  TileCache cache;
+  const TileKey absent = packTileKey(10, 1, 2);
+  EXPECT_TRUE(cache.find(absent).isNull());
+
+  cache.insert(absent, QByteArray());
+  QByteArray cached = cache.find(absent);
+  EXPECT_FALSE(cached.isNull());
+  EXPECT_TRUE(cached.isEmpty());
+  EXPECT_TRUE(cache.contains(absent));
+
+  TileCache::Statistics stats = cache.statistics();
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.missing, 1);
+  EXPECT_GT(stats.bytes, 0);
+
+  // A download replaces the negative entry with the payload.
+  cache.insert(absent, QByteArray(10, 'x'));
+  EXPECT_EQ(cache.find(absent), QByteArray(10, 'x'));
+  EXPECT_EQ(cache.statistics().missing, 0);
+  EXPECT_EQ(cache.statistics().bytes, 10);
+
+  cache.remove(absent);
+  EXPECT_TRUE(cache.find(absent).isNull());
+}
+
+// Missing tiles are charged a nominal size, an unbounded stream of them still evicts.
+TEST(TileCache, MissingTilesCountAgainstBudget)
+{
+  TileCache cache(16 * 1'024);
+  for(int x = 0; x < 10'000; x++)
+    cache.insert(packTileKey(18, x, 0), QByteArray());
+
+  TileCache::Statistics stats = cache.statistics();
+  EXPECT_LE(stats.bytes, 16 * 1'024);
+  EXPECT_LT(stats.entries, 10'000);
+  EXPECT_EQ(stats.entries, stats.missing);
+  EXPECT_GT(stats.evictions, 0u);
+}
+
+TEST(TileCache, EvictsLeastRecentlyUsed)
+{
+  TileCache cache(16 * 4 * 100);
+  const TileKey first = packTileKey(5, 0, 0);
+  cache.insert(first, QByteArray(100, 'a'));
+  for(int x = 1; x < 400; x++)
+  {
+    ASSERT_FALSE(cache.find(first).isNull()) << x;
+    cache.insert(packTileKey(5, x % 32, x / 32), QByteArray(100, 'b'));
+  }
+  EXPECT_LE(cache.statistics().bytes, 16 * 4 * 100);
+}
+
+TEST(TileLoaderCache, MissingTileIsReadOnce)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  TileLoader loader(directory.path());
+
+  EXPECT_TRUE(loader.tileAt(12, 5, 5).isEmpty());
+  EXPECT_TRUE(loader.tileAt(12, 5, 5).isEmpty());
+  QVariantMap stats = loader.cacheStatistics();
+  EXPECT_EQ(stats.value("misses").toULongLong(), 1u);
+  EXPECT_EQ(stats.value("hits").toULongLong(), 1u);
+  EXPECT_EQ(stats.value("missing").toInt(), 1);
+}
+
+TEST(TileLoaderCache, StatisticsNotificationIsThrottled)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  TileLoader loader(directory.path());
+  int notifications = 0;
+  QObject::connect(&loader, &TileLoader::cacheStatisticsChanged, [&notifications]() { notifications++; });
+
+  for(int i = 0; i < 1'000; i++)
+    (void)loader.tileAt(8, i % 16, i / 16);
+  EXPECT_EQ(notifications, 0);
+  ASSERT_TRUE(waitFor([&]() { return notifications > 0; }, 2'000));
+  EXPECT_EQ(notifications, 1);
+}
+
+TEST(TileLoaderCache, PrefetchWarmsNeighboursInBackground)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  {
+    DirectoryTileStorage storage(directory.path());
+    for(int dx = -1; dx <= 1; dx++)
+      for(int dy = -1; dy <= 1; dy++)
+        storage.write(14, 100 + dx, 200 + dy, QByteArray(64, 't'));
+  }
+
+  TileLoader loader(directory.path());
+  loader.setPrefetch(true);
+  EXPECT_EQ(loader.tileAt(14, 100, 200), QByteArray(64, 't'));
+
+  // 8 neighbours, the parent and 4 children arrive from the worker, absent ones as missing entries.
+  ASSERT_TRUE(waitFor([&]() { return loader.cacheStatistics().value("entries").toInt() == 14; }));
+  EXPECT_EQ(loader.cacheStatistics().value("missing").toInt(), 5);
+  EXPECT_EQ(loader.tileAt(14, 101, 201), QByteArray(64, 't'));
+  EXPECT_EQ(loader.cacheStatistics().value("misses").toULongLong(), 1u);
+}
@@ -0,0 +1,138 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <vector>
+#include <gtest/gtest.h>
+#include <QtCore/QTemporaryDir>
+#include <QtPositioning/QGeoPolygon>
+#include "CCL/TileCoverage"
+#include "CCL/TileLoader"
+#include "CCL/TileStorage"
+#include "fixtures.h"
+#include "httpstub.h"
+
+#define in :
+
+using namespace CCL;
+using namespace CCL::Testing;
+using std::vector;
+
+namespace
+{
+  bool allStored(const TileStorage& storage, const vector<TileKey>& tiles)
+  {
+    for(TileKey key in tiles)
+      if(not storage.contains(tileKeyZoom(key), tileKeyX(key), tileKeyY(key)))
+        return false;
+    return true;
+  }
+
+  /// Small polygon in the middle of tile (x, y) at `zoom`, hence inside exactly one tile per level up to it.
+  QGeoPolygon insideTile(uint32_t x, uint32_t y, uint8_t zoom)
+  {
+    QGeoCoordinate center((TileLoader::tileYToLatitude(y, zoom) + TileLoader::tileYToLatitude(y + 1, zoom)) / 2,
+                          (TileLoader::tileXToLongitude(x, zoom) + TileLoader::tileXToLongitude(x + 1, zoom)) / 2);
+    return regularPolygon(center, 20, 6);
+  }
+} // namespace
+
+TEST(TileMath, WorldEdges)
+{
+  for(uint8_t zoom = 0; zoom <= 20; zoom++)
+  {
+    const uint32_t last = (1u << zoom) - 1;
+    EXPECT_EQ(TileLoader::longitudeToTileX(-180, zoom), 0u);
+    EXPECT_EQ(TileLoader::longitudeToTileX(179.9999, zoom), last);
+    EXPECT_EQ(TileLoader::latitudeToTileY(85.05112, zoom), 0u);
+    EXPECT_EQ(TileLoader::latitudeToTileY(-85.05112, zoom), last);
+    EXPECT_NEAR(TileLoader::tileYToLatitude(0, zoom), 85.0511287798, 1e-9);
+    EXPECT_NEAR(TileLoader::tileYToLatitude(last + 1, zoom), -85.0511287798, 1e-9);
+    EXPECT_DOUBLE_EQ(TileLoader::tileXToLongitude(0, zoom), -180);
+  }
+}
+
+TEST(TileMath, KnownTiles)
+{
+  EXPECT_EQ(TileLoader::longitudeToTileX(2.2945, 15), 16'592u);
+  EXPECT_EQ(TileLoader::latitudeToTileY(48.8584, 15), 11'272u);
+  EXPECT_EQ(TileLoader::longitudeToTileX(151.2153, 12), 3'768u);
+  EXPECT_EQ(TileLoader::latitudeToTileY(-33.8568, 12), 2'457u);
+}
+
+// Tile corners map back into the tile they start: x grows eastwards, y grows southwards.
+TEST(TileMath, CornersRoundTrip)
+{
+  for(uint8_t zoom in { 1, 8, 14, 20 })
+  {
+    const uint32_t count = 1u << zoom;
+    for(uint32_t i in { 0u, 1u, count / 3, count / 2, count - 1 })
+    {
+      EXPECT_EQ(TileLoader::longitudeToTileX(TileLoader::tileXToLongitude(i, zoom) + 1e-9, zoom), i);
+      EXPECT_EQ(TileLoader::latitudeToTileY(TileLoader::tileYToLatitude(i, zoom) - 1e-9, zoom), i);
+    }
+  }
+}
+
+TEST(TileLoaderEstimate, OneTilePerLevelInsideATile)
+{
+  QGeoPolygon polygon = insideTile(9'904, 5'122, 14);
+  for(int zoom = 0; zoom <= 14; zoom++)
+    EXPECT_EQ(TileLoader::estimate(toVariantList(polygon), zoom), zoom + 1);
+}
+
+TEST(TileLoaderEstimate, MatchesCoverageAndGrowsWithZoom)
+{
+  QGeoPolygon polygon = starPolygon({ 55.75, 37.61 }, 25'000, 12);
+  int previous = 0;
+  for(int zoom = 0; zoom <= 16; zoom++)
+  {
+    int estimate = TileLoader::estimate(toVariantList(polygon), zoom);
+    EXPECT_EQ(static_cast<uint64_t>(estimate), TileCoverage(polygon).count(0, zoom));
+    EXPECT_GT(estimate, previous);
+    previous = estimate;
+  }
+}
+
+TEST(TileLoaderDownload, FetchesEveryCoveredTileOnce)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  HttpStub stub;
+  TileLoader loader(directory.path());
+  loader.setServerUrl(stub.urlTemplate());
+
+  QGeoPolygon area = regularPolygon({ 55.75, 37.61 }, 3'000, 8);
+  vector<TileKey> tiles = coveredTiles(area, 0, 14);
+  loader.download(toVariantList(area), 14);
+
+  DirectoryTileStorage storage(directory.path());
+  ASSERT_TRUE(waitFor([&]() { return allStored(storage, tiles); }));
+  EXPECT_EQ(stub.requests(), static_cast<int>(tiles.size()));
+  for(TileKey key in tiles)
+    EXPECT_EQ(loader.tileAt(tileKeyZoom(key), tileKeyX(key), tileKeyY(key)), stub.payload());
+}
+
+TEST(TileLoaderDownload, SkipsTilesAlreadyStored)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  HttpStub stub;
+  TileLoader loader(directory.path());
+  loader.setServerUrl(stub.urlTemplate());
+
+  QGeoPolygon area = regularPolygon({ -33.86, 151.21 }, 1'500, 5);
+  vector<TileKey> tiles = coveredTiles(area, 0, 13);
+  loader.download(toVariantList(area), 13);
+
+  DirectoryTileStorage storage(directory.path());
+  ASSERT_TRUE(waitFor([&]() { return allStored(storage, tiles); }));
+  int served = stub.requests();
+
+  loader.download(toVariantList(area), 13);
+  waitFor([]() { return false; }, 200);
+  EXPECT_EQ(stub.requests(), served);
+}
@@ -0,0 +1,330 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <optional>
+#include <vector>
+#include <gtest/gtest.h>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include "CCL/Metrics"
+#include "CCL/TileLoader"
+#include "CCL/TileScheduler"
+#include "fixtures.h"
+#include "httpstub.h"
+
+#define in :
+
+using namespace CCL;
+using namespace CCL::Testing;
+using std::vector;
+using Result = TileScheduler::Result;
+
+namespace
+{
+  vector<TileScheduler::Request> takeAll(TileScheduler& scheduler)
+  {
+    vector<TileScheduler::Request> ret;
+    while(auto request = scheduler.take())
+      ret.push_back(*request);
+    return ret;
+  }
+} // namespace
+
+TEST(TileScheduler, SameTileForTwoJobsIsRequestedOnce)
+{
+  TileScheduler scheduler;
+  const TileKey key = packTileKey(10, 3, 4);
+  int first = scheduler.addJob(key);
+  int second = scheduler.addJob(key);
+
+  auto requests = takeAll(scheduler);
+  ASSERT_EQ(requests.size(), 1u);
+  EXPECT_EQ(scheduler.finished(), 0u);
+  EXPECT_EQ(scheduler.total(), 2u);
+
+  EXPECT_EQ(scheduler.complete(requests[0], Result::Success, 10), -1);
+  EXPECT_EQ(scheduler.completed(), 2u);
+  EXPECT_EQ(scheduler.finished(), scheduler.total());
+  EXPECT_TRUE(scheduler.isCancelled(first));
+  EXPECT_TRUE(scheduler.isCancelled(second));
+  EXPECT_TRUE(scheduler.isIdle());
+}
+
+TEST(TileScheduler, CancellingOwnerHandsQueuedTileOver)
+{
+  TileScheduler scheduler;
+  const TileKey key = packTileKey(10, 3, 4);
+  int first = scheduler.addJob(key);
+  int second = scheduler.addJob(key);
+
+  scheduler.cancel(first);
+  EXPECT_TRUE(scheduler.isWanted(key));
+  auto requests = takeAll(scheduler);
+  ASSERT_EQ(requests.size(), 1u);
+  EXPECT_EQ(requests[0].job, second);
+
+  scheduler.complete(requests[0], Result::Success, 10);
+  EXPECT_EQ(scheduler.completed(), 1u);
+  EXPECT_TRUE(scheduler.isIdle());
+}
+
+TEST(TileScheduler, CancellingOwnerKeepsInFlightTileForOthers)
+{
+  TileScheduler scheduler;
+  const TileKey key = packTileKey(10, 3, 4);
+  int first = scheduler.addJob(key);
+  auto requests = takeAll(scheduler);
+  ASSERT_EQ(requests.size(), 1u);
+  scheduler.addJob(key);
+
+  scheduler.cancel(first);
+  EXPECT_TRUE(scheduler.isWanted(key));
+  scheduler.complete(requests[0], Result::Success, 10);
+  EXPECT_EQ(scheduler.completed(), 1u);
+  EXPECT_EQ(scheduler.finished(), scheduler.total());
+  EXPECT_TRUE(scheduler.isIdle());
+}
+
+// Aborted for a cancel, then asked for again before the abort landed: the tile is requested anew.
+TEST(TileScheduler, CancelledRequestIsReissuedWhenWantedAgain)
+{
+  TileScheduler scheduler;
+  const TileKey key = packTileKey(10, 3, 4);
+  int first = scheduler.addJob(key);
+  auto requests = takeAll(scheduler);
+  scheduler.cancel(first);
+  EXPECT_FALSE(scheduler.isWanted(key));
+
+  int second = scheduler.addJob(key);
+  EXPECT_TRUE(takeAll(scheduler).empty());
+  EXPECT_EQ(scheduler.complete(requests[0], Result::Cancelled, 10), -1);
+
+  requests = takeAll(scheduler);
+  ASSERT_EQ(requests.size(), 1u);
+  EXPECT_EQ(requests[0].job, second);
+  scheduler.complete(requests[0], Result::Success, 10);
+  EXPECT_EQ(scheduler.completed(), 1u);
+  EXPECT_EQ(scheduler.failed(), 0u);
+  EXPECT_TRUE(scheduler.isIdle());
+}
+
+TEST(TileScheduler, RetriesThenFailsEveryWaitingJob)
+{
+  TileScheduler scheduler;
+  TileScheduler::Limits limits = scheduler.limits();
+  limits.max_attempts = 3;
+  scheduler.setLimits(limits);
+
+  const TileKey key = packTileKey(12, 7, 7);
+  scheduler.addJob(key);
+  scheduler.addJob(key);
+  for(int attempt = 0; attempt < 3; attempt++)
+  {
+    auto requests = takeAll(scheduler);
+    ASSERT_EQ(requests.size(), 1u);
+    EXPECT_EQ(requests[0].attempt, attempt);
+    int delay = scheduler.complete(requests[0], Result::RetryableFailure, 10);
+    if(attempt < 2)
+    {
+      EXPECT_GE(delay, 0);
+      EXPECT_FALSE(scheduler.isIdle());
+      scheduler.requeue(requests[0]);
+    }
+    else
+      EXPECT_EQ(delay, -1);
+  }
+  EXPECT_EQ(scheduler.failed(), 2u);
+  EXPECT_TRUE(scheduler.isIdle());
+}
+
+TEST(TileScheduler, RequeueOfCancelledJobLeavesSchedulerIdle)
+{
+  TileScheduler scheduler;
+  int job = scheduler.addJob(packTileKey(12, 7, 7));
+  auto requests = takeAll(scheduler);
+  ASSERT_GE(scheduler.complete(requests[0], Result::RetryableFailure, 10), 0);
+
+  scheduler.cancel(job);
+  EXPECT_FALSE(scheduler.isIdle());
+  scheduler.requeue(requests[0]);
+  EXPECT_TRUE(scheduler.isIdle());
+  EXPECT_TRUE(takeAll(scheduler).empty());
+}
+
+TEST(TileScheduler, OverlappingAreasShareRequests)
+{
+  TileScheduler scheduler;
+  QGeoPolygon area = regularPolygon({ 55.75, 37.61 }, 2'000, 8);
+  scheduler.addJob(TileCoverage(area), 0, 14);
+  scheduler.addJob(TileCoverage(area), 0, 14);
+  const uint64_t tiles = TileCoverage(area).count(0, 14);
+
+  TileScheduler::Limits limits = scheduler.limits();
+  limits.min_parallel = limits.max_parallel = 1'000;
+  scheduler.setLimits(limits);
+
+  uint64_t requested = 0;
+  while(not scheduler.isIdle())
+  {
+    auto requests = takeAll(scheduler);
+    ASSERT_FALSE(requests.empty());
+    requested += requests.size();
+    for(const auto& request in requests)
+      scheduler.complete(request, Result::Success, 10);
+  }
+  EXPECT_EQ(requested, tiles);
+  EXPECT_EQ(scheduler.completed(), 2 * tiles);
+}
+
+// An area already on disk must not be walked in one take(): the predicate reads storage on the GUI thread.
+TEST(TileScheduler, SkipChecksAreBudgetedPerTake)
+{
+  TileScheduler scheduler;
+  int checks = 0;
+  scheduler.setSkipPredicate([&checks](TileKey) {
+    checks++;
+    return true;
+  });
+  QGeoPolygon area = regularPolygon({ 55.75, 37.61 }, 20'000, 8);
+  const uint64_t tiles = TileCoverage(area).count(0, 14);
+  ASSERT_GT(tiles, 512u);
+  scheduler.addJob(TileCoverage(area), 0, 14);
+
+  int turns = 0;
+  while(not scheduler.isIdle())
+  {
+    const int before = checks;
+    EXPECT_FALSE(scheduler.take().has_value());
+    EXPECT_LE(checks - before, 256);
+    EXPECT_EQ(scheduler.refillPending(), not scheduler.isIdle());
+    ASSERT_LT(++turns, 10'000);
+  }
+  EXPECT_EQ(static_cast<uint64_t>(checks), tiles);
+  EXPECT_EQ(scheduler.skipped(), tiles);
+  EXPECT_GT(turns, 1);
+}
+
+TEST(TileLoaderDownload, StalledTileTimesOutAndIsRetried)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  HttpStub stub;
+  stub.stall(5, 1, 1, 1);
+  TileLoader loader(directory.path());
+  loader.setServerUrl(stub.urlTemplate());
+  loader.setTransferTimeout(300);
+
+  loader.download(5, 1, 1);
+  DirectoryTileStorage storage(directory.path());
+  ASSERT_TRUE(waitFor([&]() { return storage.contains(5, 1, 1); }));
+  EXPECT_EQ(stub.requests(5, 1, 1), 2);
+  EXPECT_EQ(loader.failedTiles(), 0);
+}
+
+TEST(TileLoaderDownload, ServerErrorIsRetriedNotFoundIsNot)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  HttpStub stub;
+  stub.stall(6, 0, 0);
+  stub.fail(6, 2, 2, 503, 1);
+  stub.fail(6, 3, 3, 404);
+  TileLoader loader(directory.path());
+  loader.setServerUrl(stub.urlTemplate());
+
+  // The stalled tile keeps the loader busy, so failure counters are not reset under the test.
+  loader.download(6, 0, 0);
+  loader.download(6, 2, 2);
+  loader.download(6, 3, 3);
+
+  DirectoryTileStorage storage(directory.path());
+  ASSERT_TRUE(waitFor([&]() { return storage.contains(6, 2, 2) and loader.failedTiles() == 1; }));
+  EXPECT_EQ(stub.requests(6, 2, 2), 2);
+  EXPECT_EQ(stub.requests(6, 3, 3), 1);
+  EXPECT_FALSE(storage.contains(6, 3, 3));
+  loader.cancelAll();
+}
+
+// Rescheduled attempts, aborts for a cancel and tiles given up on are counted apart.
+TEST(TileLoaderDownload, MetricsSeparateRetriesCancellationsAndFailures)
+{
+  if(not Metrics::enabled())
+    GTEST_SKIP() << "built without CCL_METRICS_ENABLED";
+
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  HttpStub stub;
+  stub.stall(6, 0, 0);
+  stub.fail(6, 2, 2, 503, 1);
+  stub.fail(6, 3, 3, 404);
+  TileLoader loader(directory.path());
+  loader.setServerUrl(stub.urlTemplate());
+  Metrics::reset();
+
+  int stalled = loader.download(6, 0, 0);
+  loader.download(6, 2, 2);
+  loader.download(6, 3, 3);
+  DirectoryTileStorage storage(directory.path());
+  ASSERT_TRUE(waitFor([&]() { return storage.contains(6, 2, 2) and loader.failedTiles() == 1; }));
+  loader.cancel(stalled);
+
+  auto counter = [](const char* name) { return Metrics::snapshot().value("counters").toMap().value(name).toULongLong(); };
+  ASSERT_TRUE(waitFor([&]() { return counter("tileCancellations") == 1; }));
+  EXPECT_EQ(counter("tileRequests"), 4u);
+  EXPECT_EQ(counter("tileRetries"), 1u);
+  EXPECT_EQ(counter("tileFailures"), 1u);
+}
+
+// A second job over the same area rides on the first one's requests.
+TEST(TileLoaderDownload, DuplicateJobsShareRequests)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  HttpStub stub;
+  TileLoader loader(directory.path());
+  loader.setServerUrl(stub.urlTemplate());
+
+  QGeoPolygon area = regularPolygon({ 48.85, 2.29 }, 1'000, 6);
+  vector<TileKey> tiles = coveredTiles(area, 0, 13);
+  loader.download(toVariantList(area), 13);
+  loader.download(toVariantList(area), 13);
+
+  DirectoryTileStorage storage(directory.path());
+  ASSERT_TRUE(waitFor([&]() {
+    for(TileKey key in tiles)
+      if(not storage.contains(tileKeyZoom(key), tileKeyX(key), tileKeyY(key)))
+        return false;
+    return true;
+  }));
+  waitFor([]() { return false; }, 200);
+  EXPECT_EQ(stub.requests(), static_cast<int>(tiles.size()));
+}
+
+// Cancelling a job whose tile waits for a retry must still reach the idle handling, which flushes the pack.
+TEST(TileLoaderDownload, CancelDuringBackoffReachesIdle)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  HttpStub stub;
+  stub.fail(7, 1, 1, 503);
+  TileLoader loader(directory.path());
+  loader.setServerUrl(stub.urlTemplate());
+  loader.setStorageBackend(TileLoader::Packed);
+
+  // Flushed records show as growth of the pack; opening a second storage on it would race the loader's.
+  const QString pack = directory.path() + "/tiles.pack";
+  const qint64 empty = QFile(pack).size();
+  loader.download(7, 0, 0);
+  int job = loader.download(7, 1, 1);
+  ASSERT_TRUE(waitFor([&]() { return stub.requests(7, 0, 0) == 1 and stub.requests(7, 1, 1) == 1; }));
+  waitFor([]() { return false; }, 50);
+  loader.cancel(job);
+
+  EXPECT_TRUE(waitFor([&]() { return QFile(pack).size() > empty; }, 3'000));
+  EXPECT_FALSE(loader.tileAt(7, 0, 0).isEmpty());
+  EXPECT_EQ(stub.requests(7, 1, 1), 1);
+}
@@ -0,0 +1,260 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include "CCL/TileLoader"
+#include "CCL/TileStorage"
+
+#define in :
+
+using namespace CCL;
+using std::vector;
+
+namespace
+{
+  /// Distinct payload per tile so a misplaced offset cannot go unnoticed.
+  QByteArray payloadOf(int zoom, int x, int y) { return QByteArray(100 + (x * 7 + y) % 300, static_cast<char>('a' + (zoom + x + y) % 26)); }
+} // namespace
+
+TEST(PackedTileStorage, ReadsPendingFlushedAndReopened)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  const QString path = directory.path() + "/tiles.pack";
+  {
+    PackedTileStorage storage(path, 1'024 * 1'024, 1'000);
+    for(int x = 0; x < 50; x++)
+      storage.write(12, x, 7, payloadOf(12, x, 7));
+    EXPECT_EQ(storage.size(), 50);
+    EXPECT_EQ(storage.read(12, 3, 7), payloadOf(12, 3, 7));
+
+    storage.flush();
+    EXPECT_TRUE(storage.contains(12, 49, 7));
+    EXPECT_FALSE(storage.contains(12, 50, 7));
+    EXPECT_EQ(storage.read(12, 49, 7), payloadOf(12, 49, 7));
+    EXPECT_TRUE(storage.read(12, 50, 7).isNull());
+  }
+
+  PackedTileStorage reopened(path);
+  EXPECT_EQ(reopened.size(), 50);
+  for(int x = 0; x < 50; x++)
+    EXPECT_EQ(reopened.read(12, x, 7), payloadOf(12, x, 7));
+}
+
+// A tiny window forces many tail mappings; records must read the same before and after they are mapped.
+TEST(PackedTileStorage, ReadsAcrossMapWindows)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  PackedTileStorage storage(directory.path() + "/tiles.pack", 1'024 * 1'024, 3, 4'096);
+
+  for(int x = 0; x < 64; x++)
+  {
+    for(int y = 0; y < 8; y++)
+      storage.write(15, x, y, payloadOf(15, x, y));
+    for(int previous = 0; previous <= x; previous++)
+      ASSERT_EQ(storage.read(15, previous, 5), payloadOf(15, previous, 5)) << previous << " after " << x;
+  }
+
+  // Rewritten tile resolves to the newest record.
+  storage.write(15, 0, 0, "fresh");
+  storage.flush();
+  EXPECT_EQ(storage.read(15, 0, 0), QByteArray("fresh"));
+  EXPECT_EQ(storage.size(), 64 * 8);
+}
+
+namespace
+{
+  /// Writes tiles (10, 1, 1..count), one flush each. Returns the pack length after every flush.
+  vector<qint64> seedPack(const QString& path, int count)
+  {
+    vector<qint64> ret;
+    PackedTileStorage storage(path);
+    for(int y = 1; y <= count; y++)
+    {
+      storage.write(10, 1, y, payloadOf(10, 1, y));
+      storage.flush();
+      ret.push_back(QFile(path).size());
+    }
+    return ret;
+  }
+
+  QByteArray readFile(const QString& path)
+  {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+  }
+
+  void appendFile(const QString& path, const QByteArray& data)
+  {
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::Append));
+    file.write(data);
+  }
+} // namespace
+
+TEST(PackedTileStorage, TruncatesTornRecord)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  const QString path = directory.path() + "/tiles.pack";
+  const vector<qint64> lengths = seedPack(path, 2);
+
+  // Last record again, cut short as left by a crash mid-append: its header claims more than the file holds.
+  QByteArray last = readFile(path).mid(static_cast<int>(lengths[0]));
+  appendFile(path, last.left(last.size() - 10));
+  {
+    PackedTileStorage storage(path);
+    EXPECT_EQ(storage.size(), 2);
+    EXPECT_EQ(QFile(path).size(), lengths[1]);
+    storage.write(10, 1, 3, payloadOf(10, 1, 3));
+  }
+
+  PackedTileStorage reopened(path);
+  EXPECT_EQ(reopened.read(10, 1, 3), payloadOf(10, 1, 3));
+}
+
+// Space the file system extended but never wrote reads back as zeros, none of it is a 0/0/0 tile.
+TEST(PackedTileStorage, TruncatesZeroFilledTail)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  const QString path = directory.path() + "/tiles.pack";
+  const vector<qint64> lengths = seedPack(path, 2);
+
+  appendFile(path, QByteArray(4'096, '\0'));
+  PackedTileStorage storage(path);
+  EXPECT_EQ(storage.size(), 2);
+  EXPECT_FALSE(storage.contains(0, 0, 0));
+  EXPECT_EQ(QFile(path).size(), lengths[1]);
+}
+
+// A damaged payload is only noticed by the scan; with the index intact the records are not walked at all.
+TEST(PackedTileStorage, OpensFromIndexWithoutScanning)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  const QString path = directory.path() + "/tiles.pack";
+  const vector<qint64> lengths = seedPack(path, 3);
+
+  QByteArray pack = readFile(path);
+  const int damaged = static_cast<int>(lengths[0]) + 40;
+  pack[damaged] = static_cast<char>(pack[damaged] ^ 0x01);
+  {
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(pack);
+  }
+
+  EXPECT_EQ(PackedTileStorage(path).size(), 3);
+
+  ASSERT_TRUE(QFile::remove(path + ".idx"));
+  PackedTileStorage rescanned(path);
+  EXPECT_EQ(rescanned.size(), 1);
+  EXPECT_TRUE(rescanned.contains(10, 1, 1));
+  EXPECT_EQ(QFile(path).size(), lengths[0]);
+}
+
+TEST(PackedTileStorage, RecoversRecordsPastTheIndex)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  const QString path = directory.path() + "/tiles.pack";
+  seedPack(path, 1);
+  const QByteArray early_index = readFile(path + ".idx");
+  {
+    PackedTileStorage storage(path);
+    storage.write(10, 1, 2, payloadOf(10, 1, 2));
+    storage.write(10, 1, 3, payloadOf(10, 1, 3));
+  }
+
+  // Index as of the first flush, the later records are found by scanning the tail it does not cover.
+  {
+    QFile index(path + ".idx");
+    ASSERT_TRUE(index.open(QIODevice::WriteOnly));
+    index.write(early_index);
+  }
+  {
+    PackedTileStorage storage(path);
+    EXPECT_EQ(storage.size(), 3);
+    EXPECT_EQ(storage.read(10, 1, 3), payloadOf(10, 1, 3));
+  }
+  EXPECT_GT(readFile(path + ".idx").size(), early_index.size());
+  EXPECT_EQ(PackedTileStorage(path).size(), 3);
+}
+
+// An index left behind by another pack at the same path, or one claiming more than the pack holds, is ignored.
+TEST(PackedTileStorage, IgnoresStaleIndex)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  const QString path = directory.path() + "/tiles.pack";
+  seedPack(path, 3);
+  const QByteArray foreign_index = readFile(path + ".idx");
+
+  ASSERT_TRUE(QFile::remove(path));
+  const vector<qint64> lengths = seedPack(path, 1);
+  {
+    QFile index(path + ".idx");
+    ASSERT_TRUE(index.open(QIODevice::WriteOnly));
+    index.write(foreign_index);
+  }
+  {
+    PackedTileStorage storage(path);
+    EXPECT_EQ(storage.size(), 1);
+    EXPECT_EQ(storage.read(10, 1, 1), payloadOf(10, 1, 1));
+    storage.write(10, 1, 2, payloadOf(10, 1, 2));
+  }
+
+  // Pack cut back behind the index, as by an interrupted copy.
+  {
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    ASSERT_TRUE(file.resize(lengths[0]));
+  }
+  PackedTileStorage truncated(path);
+  EXPECT_EQ(truncated.size(), 1);
+  EXPECT_FALSE(truncated.contains(10, 1, 2));
+}
+
+TEST(DirectoryTileStorage, RoundTrip)
+{
+  QTemporaryDir directory;
+  ASSERT_TRUE(directory.isValid());
+  DirectoryTileStorage storage(directory.path());
+  storage.write(3, 2, 1, payloadOf(3, 2, 1));
+  EXPECT_TRUE(storage.contains(3, 2, 1));
+  EXPECT_FALSE(storage.contains(3, 1, 2));
+  EXPECT_EQ(storage.read(3, 2, 1), payloadOf(3, 2, 1));
+  EXPECT_TRUE(QFile::exists(directory.path() + "/3/2/1"));
+}
+
+// tileAt results must outlive the storage they were read from, the loader replaces it on url change.
+TEST(TileLoaderStorage, TileAtOutlivesStorageSwap)
+{
+  QTemporaryDir first, second;
+  ASSERT_TRUE(first.isValid() and second.isValid());
+  {
+    PackedTileStorage seed(first.path() + "/tiles.pack");
+    seed.write(14, 100, 200, payloadOf(14, 100, 200));
+  }
+
+  TileLoader loader(first.path());
+  loader.setStorageBackend(TileLoader::Packed);
+  QByteArray tile = loader.tileAt(14, 100, 200);
+  ASSERT_EQ(tile, payloadOf(14, 100, 200));
+
+  loader.setStorageUrl(second.path());
+  loader.setStorage(std::make_unique<DirectoryTileStorage>(second.path()));
+  EXPECT_EQ(tile, payloadOf(14, 100, 200));
+  EXPECT_TRUE(loader.tileAt(14, 100, 200).isEmpty());
+}
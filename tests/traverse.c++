@@ -0,0 +1,197 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include <QtPositioning/QGeoPath>
+#include <QtPositioning/QGeoPolygon>
+#include "CCL/Geomath"
+#include "CCL/Traverse"
+#include "fixtures.h"
+#include "legacytraverse.h"
+
+#define in :
+
+using namespace CCL;
+using namespace CCL::Testing;
+using std::vector;
+
+namespace
+{
+  const QGeoCoordinate CENTER(55.75, 37.61);
+
+  vector<std::pair<double, double>> sortedPoints(const QGeoPath& path)
+  {
+    vector<std::pair<double, double>> ret;
+    for(const QGeoCoordinate& point in path.path())
+      ret.emplace_back(point.latitude(), point.longitude());
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+  /// Distance in meters from `point` to the closest edge of the outline.
+  double distanceToOutline(const QGeoPolygon& polygon, const QGeoCoordinate& point)
+  {
+    LocalTangentFrame frame(polygon.path().front());
+    NEDPoint p = frame.toNED(point);
+    double ret = std::numeric_limits<double>::max();
+    for(int i = 0; i < polygon.size(); i++)
+    {
+      NEDPoint a = frame.toNED(polygon.coordinateAt(i));
+      NEDPoint b = frame.toNED(polygon.coordinateAt((i + 1) % polygon.size()));
+      double dx = b.x - a.x, dy = b.y - a.y;
+      double t = std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / (dx * dx + dy * dy), 0.0, 1.0);
+      ret = std::min(ret, std::hypot(p.x - a.x - t * dx, p.y - a.y - t * dy));
+    }
+    return ret;
+  }
+} // namespace
+
+class TraverseVertices : public ::testing::TestWithParam<int> {};
+
+TEST_P(TraverseVertices, ConvexPolygonIsCoveredByParallelTransects)
+{
+  const double radius = 500;
+  const float spacing = 10;
+  QGeoPolygon polygon = regularPolygon(CENTER, radius, GetParam());
+  QGeoPath path = Traverse::buildTraverse(polygon, 30, spacing, 0, Traverse::Entry::TopLeft);
+
+  ASSERT_GT(path.size(), 0);
+  ASSERT_EQ(path.size() % 2, 0);
+
+  // One segment per transect on a convex outline. Its width across the transects lies
+  // between the inscribed and the circumscribed circle diameters.
+  const double widest = 2 * radius;
+  const double narrowest = widest * std::cos(M_PI / GetParam());
+  EXPECT_LE(path.size() / 2, static_cast<int>(widest / spacing) + 1);
+  EXPECT_GE(path.size() / 2, static_cast<int>(narrowest / spacing));
+
+  for(const QGeoCoordinate& point in path.path())
+    EXPECT_LE(point.distanceTo(CENTER), radius + 0.5);
+}
+
+TEST_P(TraverseVertices, EntryOnlyReordersWaypoints)
+{
+  QGeoPolygon polygon = starPolygon(CENTER, 800, std::max(6, GetParam() - GetParam() % 2));
+  auto reference = sortedPoints(Traverse::buildTraverse(polygon, -15, 7.5f, 0, Traverse::Entry::TopLeft));
+  for(Traverse::Entry entry in { Traverse::Entry::TopRight, Traverse::Entry::BottomLeft, Traverse::Entry::BottomRight })
+  {
+    auto points = sortedPoints(Traverse::buildTraverse(polygon, -15, 7.5f, 0, entry));
+    ASSERT_EQ(points.size(), reference.size());
+    for(size_t i = 0; i < points.size(); i++)
+    {
+      EXPECT_NEAR(points[i].first, reference[i].first, 1e-9);
+      EXPECT_NEAR(points[i].second, reference[i].second, 1e-9);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Traverse, TraverseVertices, ::testing::Values(4, 5, 16, 100, 1'000, 10'000));
+
+class TraverseLegacy : public ::testing::TestWithParam<std::tuple<int, float>> {};
+
+// Planner centers its transects where the old grid started from a corner of the bounding square,
+// so waypoints are offset by a fraction of the spacing. The outline they end on, their heading,
+// the order they are flown in and the length they cover must agree.
+TEST_P(TraverseLegacy, ConvexPolygonMatchesLegacyBuild)
+{
+  const auto [vertices, angle] = GetParam();
+  const float spacing = 10;
+  QGeoPolygon polygon = regularPolygon(CENTER, 500, vertices);
+  QGeoPath planned = Traverse::buildTraverse(polygon, angle, spacing, 0, Traverse::Entry::TopLeft);
+  QGeoPath legacy = legacyBuildTraverse(polygon, angle, spacing, 0, Traverse::Entry::TopLeft);
+
+  ASSERT_EQ(planned.size() % 2, 0);
+  ASSERT_EQ(legacy.size() % 2, 0);
+  EXPECT_LE(std::abs(planned.size() - legacy.size()), 2);
+
+  const LocalTangentFrame frame(CENTER);
+  auto across = [&frame, angle = angle](const QGeoCoordinate& point) {
+    NEDPoint ned = frame.toNED(point);
+    return ned.y * std::cos(angle * M_PI / 180) - ned.x * std::sin(angle * M_PI / 180);
+  };
+  auto covered = [&](const QGeoPath& path) {
+    double ret = 0;
+    for(int i = 0; i < path.size(); i += 2)
+    {
+      QGeoCoordinate from = path.coordinateAt(i);
+      QGeoCoordinate to = path.coordinateAt(i + 1);
+      ret += from.distanceTo(to);
+      EXPECT_LT(distanceToOutline(polygon, from), 0.01) << i;
+      EXPECT_LT(distanceToOutline(polygon, to), 0.01) << i + 1;
+
+      // Along the azimuth either way, alternating, and one spacing further across each time.
+      double heading = std::fmod(from.azimuthTo(to) - angle + 720, 360);
+      EXPECT_LT(std::min(std::fmod(heading, 180), 180 - std::fmod(heading, 180)), 0.05) << i;
+      if(i + 2 < path.size())
+      {
+        QGeoCoordinate next = path.coordinateAt(i + 2);
+        EXPECT_NEAR(std::abs(std::fmod(next.azimuthTo(path.coordinateAt(i + 3)) - from.azimuthTo(to) + 720, 360) - 180), 0, 0.05) << i;
+        EXPECT_NEAR(across(next) - across(from), spacing, 0.01) << i;
+      }
+    }
+    return ret;
+  };
+  const double planned_length = covered(planned);
+  const double legacy_length = covered(legacy);
+  EXPECT_NEAR(planned_length, legacy_length, 0.005 * legacy_length);
+}
+
+INSTANTIATE_TEST_SUITE_P(Traverse, TraverseLegacy,
+                         ::testing::Combine(::testing::Values(4, 5, 16, 100, 1'000), ::testing::Values(0.0f, 30.0f, -45.0f, 77.0f)));
+
+// The notch tip lies exactly on the only transect, both its edges run ahead of it. The transect
+// merely touches the outline there and must stay one segment, as at a corner extreme across.
+TEST(Traverse, TransectThroughVertexIsNotSplit)
+{
+  const double d = 0.001, q = 0.0001;
+  QGeoPolygon polygon;
+  for(auto [latitude, longitude] : { std::pair { 0.0, 0.0 }, { -q, d }, { -d, d }, { -d, -d }, { -q, -d }, { q, -d }, { d, -d }, { d, d }, { q, d } })
+    polygon.addCoordinate(QGeoCoordinate(latitude, longitude));
+
+  // Symmetric about the tip's meridian, so the single centered transect runs through it.
+  Traverse::Planner planner(polygon, 0, 1'000, 10, Traverse::Entry::TopLeft);
+  ASSERT_EQ(planner.transectCount(), 1u);
+  EXPECT_EQ(planner.segmentCount(), 1u);
+  EXPECT_NEAR(planner.pathLength(), QGeoCoordinate(-d, 0).distanceTo(QGeoCoordinate(d, 0)) + 20, 0.1);
+}
+
+TEST(Traverse, TurnAroundExtendsEverySegment)
+{
+  QGeoPolygon polygon = regularPolygon(CENTER, 300, 4);
+  QGeoPath plain = Traverse::buildTraverse(polygon, 0, 20, 0, Traverse::Entry::TopLeft);
+  QGeoPath extended = Traverse::buildTraverse(polygon, 0, 20, 15, Traverse::Entry::TopLeft);
+
+  ASSERT_EQ(plain.size(), extended.size());
+  for(int i = 0; i < plain.size(); i += 2)
+  {
+    double inner = plain.coordinateAt(i).distanceTo(plain.coordinateAt(i + 1));
+    double outer = extended.coordinateAt(i).distanceTo(extended.coordinateAt(i + 1));
+    EXPECT_NEAR(outer - inner, 30, 0.05);
+    EXPECT_TRUE(std::isnan(extended.coordinateAt(i).altitude()));
+  }
+}
+
+TEST(Traverse, DegenerateInput)
+{
+  EXPECT_EQ(Traverse::buildTraverse(QGeoPolygon(), 0, 10, 0, Traverse::Entry::TopLeft).size(), 0);
+
+  QGeoPolygon segment;
+  segment.addCoordinate(CENTER);
+  segment.addCoordinate(CENTER.atDistanceAndAzimuth(100, 90));
+  EXPECT_EQ(Traverse::buildTraverse(segment, 0, 10, 0, Traverse::Entry::TopLeft).size(), 2);
+
+  EXPECT_THROW(Traverse::buildTraverse(regularPolygon(CENTER, 100, 4), 0, 0.4f, 0, Traverse::Entry::TopLeft),
+               std::invalid_argument);
+}
@@ -0,0 +1,136 @@
+/* ---------------------------------------------------------------------
+ * CCL - Cartography Convenience Library
+ * Copyright (C) 2023 radar-mms.
+ *
+ * uav.radar-mms.com/gitlab
+ * ---------------------------------------------------------------------- */
+
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include <QtCore/QFuture>
+#include <QtCore/QList>
+#include <QtPositioning/QGeoPath>
+#include <QtPositioning/QGeoPolygon>
+#include "CCL/Traverse"
+#include "CCL/TraverseBatch"
+#include "fixtures.h"
+
+#define in :
+
+using namespace CCL;
+using namespace CCL::Testing;
+using namespace CCL::Traverse;
+using std::vector;
+
+namespace
+{
+  const QGeoCoordinate CENTER(55.75, 37.61);
+
+  /// Jobs that differ in outline, angle and entry, so a misplaced result cannot match by accident.
+  QList<Job> mixedJobs(int count)
+  {
+    QList<Job> ret;
+    for(int i = 0; i < count; i++)
+    {
+      QGeoPolygon polygon = i % 2 ? starPolygon(CENTER, 500 + 100 * i, 5 + i) : regularPolygon(CENTER, 500 + 100 * i, 3 + i);
+      ret.push_back({ polygon, static_cast<float>(17 * i % 180), 20, 10, static_cast<Entry>(i % 4) });
+    }
+    return ret;
+  }
+} // namespace
+
+TEST(TraverseBatch, ResultsKeepInputOrder)
+{
+  const QList<Job> jobs = mixedJobs(24);
+  QFuture<QGeoPath> future = buildTraverseAsync(jobs);
+  future.waitForFinished();
+
+  const QList<QGeoPath> results = future.results();
+  ASSERT_EQ(results.size(), jobs.size());
+  for(int i = 0; i < jobs.size(); i++)
+  {
+    const Job& job = jobs[i];
+    EXPECT_EQ(results[i].path(), buildTraverse(job.polygon, job.angle, job.spacing, job.turn_around, job.entry).path()) << i;
+  }
+}
+
+// The replaced batch stops reporting at cancel(), a slow job still running then is dropped on completion.
+TEST(TraverseBatch, SubmitCancelsReplacedBatch)
+{
+  BatchPlanner planner;
+  QFuture<QGeoPath> replaced = planner.submit({ { regularPolygon(CENTER, 5'000, 1'000), 30, 1, 10, Entry::TopLeft } });
+  const QList<Job> jobs = mixedJobs(4);
+  QFuture<QGeoPath> current = planner.submit(jobs);
+
+  EXPECT_TRUE(replaced.isCanceled());
+  replaced.waitForFinished();
+  EXPECT_EQ(replaced.resultCount(), 0);
+
+  current.waitForFinished();
+  EXPECT_FALSE(current.isCanceled());
+  EXPECT_EQ(current.resultCount(), jobs.size());
+  EXPECT_EQ(planner.future().resultCount(), jobs.size());
+}
+
+// Every angle is planned serially here and the first one with the lowest score wins, as OrderedReduce must keep it.
+TEST(TraverseBatch, SweepPicksBestAngleEarliestOnTie)
+{
+  // Hexagon: angles 60 degrees apart plan the same transect count.
+  const QGeoPolygon polygon = regularPolygon(CENTER, 1'000, 6);
+  QList<float> angles;
+  for(int angle = 0; angle < 180; angle += 5)
+    angles.push_back(static_cast<float>(angle));
+
+  vector<SweepResult> planned;
+  for(float angle in angles)
+  {
+    Planner planner(polygon, angle, 25, 10, Entry::TopLeft);
+    planned.push_back({ angle, planner.transectCount(), planner.pathLength() });
+  }
+
+  for(Criterion criterion in { Criterion::TransectCount, Criterion::PathLength })
+  {
+    SweepResult expected;
+    int best = 0;
+    for(SweepResult candidate in planned)
+    {
+      candidate.score = criterion == Criterion::TransectCount ? static_cast<double>(candidate.transects) : candidate.length;
+      if(candidate.score == expected.score)
+        best++;
+      if(candidate.score < expected.score)
+      {
+        expected = candidate;
+        best = 1;
+      }
+    }
+    if(criterion == Criterion::TransectCount)
+      ASSERT_GT(best, 1) << "no tie to break";
+
+    SweepResult result = sweepAngles(polygon, angles, 25, 10, Entry::TopLeft, criterion).result();
+    EXPECT_EQ(result.angle, expected.angle);
+    EXPECT_EQ(result.transects, expected.transects);
+    EXPECT_DOUBLE_EQ(result.length, expected.length);
+    EXPECT_DOUBLE_EQ(result.score, expected.score);
+  }
+}
+
+TEST(TraverseBatch, InvalidInputThrowsThroughFuture)
+{
+  QFuture<QGeoPath> batch = buildTraverseAsync(mixedJobs(2) << Job { regularPolygon(CENTER, 500, 4), 0, 0.1f, 0, Entry::TopLeft });
+  EXPECT_TRUE(batch.isFinished());
+  EXPECT_THROW(batch.waitForFinished(), BatchError);
+
+  QFuture<SweepResult> sweep = sweepAngles(regularPolygon(CENTER, 500, 4), { 0, 45 }, 0.1f, 0, Entry::TopLeft);
+  try
+  {
+    (void)sweep.result();
+    FAIL() << "sweep with spacing 0.1 resolved";
+  }
+  catch(const BatchError& error)
+  {
+    EXPECT_NE(std::strstr(error.what(), "spacing"), nullptr) << error.what();
+  }
+
+  EXPECT_THROW(sweepAngles(QGeoPolygon(), { 0 }, 10, 0, Entry::TopLeft).waitForFinished(), BatchError);
+}